@@ -326,7 +326,7 @@ void align_queries(Consumer* output_file, Search::Config& cfg)
 		timer.go("Computing alignments");
 		HitIterator hit_it(query_range.first, query_range.second, hit_buf->data(), hit_buf->data() + hit_buf->size());
 		OutputWriter writer{ output_file };
-		output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(query_range.first, writer));
+		output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(query_range.first, writer, config.output_backlog));
 		unique_ptr<thread> heartbeat;
 		if (config.verbosity >= 3 && config.load_balancing == Config::query_parallel && !config.no_heartbeat && !config.swipe_all)
 			heartbeat.reset(new thread(heartbeat_worker, query_range.second, &cfg));
@@ -353,6 +353,8 @@ void align_queries(Consumer* output_file, Search::Config& cfg)
 		
 		timer.go("Deallocating buffers");
 		cfg.thread_pool.reset();
+		statistics.inc(Statistics::TIME_OUTPUT_STALL, output_sink->stall_time());
+		statistics.max(Statistics::OUTPUT_BACKLOG_PEAK, output_sink->max_size());
 		output_sink.reset();
 		last_size = hit_buf->size() * sizeof(Search::Hit);
 		res_size -= last_size;
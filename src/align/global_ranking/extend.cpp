@@ -114,7 +114,7 @@ void extend(SequenceFile& db, TempFile& merged_query_list, BitVector& ranking_db
 
 	timer.go("Computing alignments");
 	OutputWriter writer{ &master_out };
-	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer));
+	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer, config.output_backlog));
 	uint32_t next_query = 0;
 	vector<thread> threads;
 	for (size_t i = 0; i < (config.threads_align ? config.threads_align : config.threads_); ++i)
@@ -216,7 +216,7 @@ void extend(Search::Config& cfg, Consumer& out) {
 
 	timer.go("Computing alignments");
 	OutputWriter writer{ &out };
-	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer));
+	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer, config.output_backlog));
 
 	std::atomic<BlockId> next_query(0);
 	const BlockId query_count = cfg.query->seqs().size() / align_mode.query_contexts;
@@ -241,6 +241,8 @@ void Statistics::print() const
 	log_stream << "Time (Load seed hits)        = " << (double)data_[TIME_LOAD_SEED_HITS] / 1e6 << "s (wall)" << endl;
 	log_stream << "Time (Sort seed hits)        = " << (double)data_[TIME_SORT_SEED_HITS] / 1e6 << "s (wall)" << endl;
 	log_stream << "Time (Extension)             = " << (double)data_[TIME_EXT] / 1e6 << "s (wall)" << endl;
+	log_stream << "Time (Output stall)          = " << (double)data_[TIME_OUTPUT_STALL] / 1e6 << "s (wall, summed over threads)" << endl;
+	log_stream << "Output backlog peak          = " << (double)data_[OUTPUT_BACKLOG_PEAK] / (1 << 20) << " MB" << endl;
 	//log_stream << "Time (greedy extension)      = " << data_[TIME_GREEDY_EXT]/1e9 << "s" << endl;
 	//log_stream << "Gapped hits = " << data_[GAPPED_HITS] << endl;
 	//log_stream << "Overlap hits = " << data_[DUPLICATES] << endl;
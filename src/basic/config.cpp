@@ -81,7 +81,8 @@ const SEMap<Sensitivity> EnumTraits<Sensitivity>::from_string = {
 
 const SEMap<GraphAlgo> EnumTraits<GraphAlgo>::from_string = {
 	{ "gvc", GraphAlgo::GREEDY_VERTEX_COVER },
-	{ "len", GraphAlgo::LEN_SORTED }
+	{ "len", GraphAlgo::LEN_SORTED },
+	{ "cc", GraphAlgo::CONNECTED_COMPONENTS }
 };
 
 const EMap<Config::Algo> EnumTraits<Config::Algo>::to_string = { { Config::Algo::DOUBLE_INDEXED, "Double-indexed" }, { Config::Algo::QUERY_INDEXED, "Query-indexed"}, {Config::Algo::CTG_SEED, "Query-indexed with contiguous seed"} };
@@ -203,6 +204,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		.add_command("realign", "Realign clustered sequences against their centroids", CLUSTER_REALIGN)
 		.add_command("recluster", "Recompute clustering to fix errors", RECLUSTER)
 		.add_command("reassign", "Reassign clustered sequences to the closest centroid", CLUSTER_REASSIGN)
+		.add_command("compute-medoids", "Replace the cluster representatives by the cluster medoids", compute_medoids)
 		.add_command("view", "View DIAMOND alignment archive (DAA) formatted file", view)
 		.add_command("help", "Produce help message", help)
 		.add_command("version", "Display version information", version)
@@ -214,6 +216,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		.add_command("roc", "", roc)
 		.add_command("benchmark", "", benchmark)
 		.add_command("deepclust", "", DEEPCLUST)
+		.add_command("mp-coordinator", "Run the work queue coordinator for multiprocessing", MP_COORDINATOR)
 #ifdef EXTRA
 		.add_command("random-seqs", "", random_seqs)
 		.add_command("sort", "", sort)
@@ -232,7 +235,6 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		.add_command("upgma", "", upgma)
 		.add_command("upgmamc", "", upgma_mc)
 		.add_command("reverse", "", reverse_seqs)
-		.add_command("compute-medoids", "", compute_medoids)
 		.add_command("mutate", "", mutate)
 		.add_command("roc-id", "", rocid)
 		.add_command("find-shapes", "", find_shapes)
@@ -248,7 +250,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 #endif
 		;
 
-	auto& general = parser.add_group("General options", { makedb, blastp, blastx, cluster, view, prep_db, getseq, dbinfo, makeidx, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST });
+	auto& general = parser.add_group("General options", { makedb, blastp, blastx, cluster, view, prep_db, getseq, dbinfo, makeidx, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, compute_medoids });
 	general.add()
 		("threads", 'p', "number of CPU threads", threads_)
 		("db", 'd', "database file", database)
@@ -266,7 +268,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("taxonnodes", 0, "taxonomy nodes.dmp from NCBI", nodesdmp)
 		("taxonnames", 0, "taxonomy names.dmp from NCBI", namesdmp);
 
-	auto& align_clust = parser.add_group("Aligner/Clustering options", { blastp, blastx, cluster, RECLUSTER, CLUSTER_REASSIGN, DEEPCLUST, CLUSTER_REALIGN });
+	auto& align_clust = parser.add_group("Aligner/Clustering options", { blastp, blastx, cluster, RECLUSTER, CLUSTER_REASSIGN, DEEPCLUST, CLUSTER_REALIGN, compute_medoids });
 	align_clust.add()
 		("evalue", 'e', "maximum e-value to report alignments (default=0.001)", max_evalue, 0.001)
 		("tmpdir", 't', "directory for temporary files", tmpdir)
@@ -277,6 +279,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("approx-id", 0, "minimum approx. identity% to report an alignment/to cluster sequences", approx_min_id)
 		("ext", 0, "Extension mode (banded-fast/banded-slow/full)", ext_)
 		("memory-limit", 'M', "Memory limit in GB (default = 16G)", memory_limit)
+		("resume", 0, "resume an interrupted search or incremental clustering from the output file of that run", resume)
 		("mmseqs-compat", 0, "", mmseqs_compat)
 		("no-block-size-limit", 0, "", no_block_size_limit);
 
@@ -323,6 +326,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("no-self-hits", 0, "suppress reporting of identical self hits", no_self_hits)
 		("taxonlist", 0, "restrict search to list of taxon ids (comma-separated)", taxonlist)
 		("taxon-exclude", 0, "exclude list of taxon ids (comma-separated)", taxon_exclude)
+		("taxon-index", 0, "build a taxonomy filter index next to the database to speed up taxonomic filtering", taxon_index)
 		("seqidlist", 0, "filter the database by list of accessions", seqidlist)
 		("skip-missing-seqids", 0, "ignore accessions missing in the database", skip_missing_seqids);
 
@@ -387,12 +391,16 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("member-cover", 0, "Minimum coverage% of the cluster member sequence (default=80.0)", member_cover, 80.0)
 		("cluster-steps", 0, "Clustering steps", cluster_steps)
 		("centroid-out", 0, "Output file for centroids (greedy vertex cover workflow)", centroid_out)
+		("graph-algo", 0, "Graph algorithm for the clustering rounds (gvc/len/cc, default=gvc)", graph_algo, string("gvc"))
+		("cluster-algo", 0, "Clustering algorithm (cascaded/incremental/mcl, default=cascaded; mcl requires a build with MCL support)", cluster_algo)
+		("update", 0, "Update the incremental clustering of a previous run (output file of that run) with the new sequences appended to the database", cluster_update)
+		("seed-cache-size", 0, "Memory for reference seed arrays reused by later clustering rounds (default=1/8 of the memory limit, 0=disabled)", seed_cache_size)
 #ifdef KEEP_TARGET_ID
 		("kmer-ranking", 0, "Rank sequences based on kmer frequency in linear stage", kmer_ranking)
 #endif
 		;
 
-	auto& realign_opt = parser.add_group("Cluster input options", { CLUSTER_REALIGN, RECLUSTER, CLUSTER_REASSIGN, GREEDY_VERTEX_COVER });
+	auto& realign_opt = parser.add_group("Cluster input options", { CLUSTER_REALIGN, RECLUSTER, CLUSTER_REASSIGN, GREEDY_VERTEX_COVER, compute_medoids });
 	realign_opt.add()
 		("clusters", 0, "Clustering input file mapping sequences to centroids", clustering)
 		("edges", 0, "Input file for greedy vertex cover", edges)
@@ -418,6 +426,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("mp-init", 0, "initialize multiprocessing run", mp_init)
 		("mp-recover", 0, "enable continuation of interrupted multiprocessing run", mp_recover)
 		("mp-query-chunk", 0, "process only a single query chunk as specified", mp_query_chunk, -1)
+		("checkpoint", 0, "write checkpoints to allow resuming an interrupted run with --resume", checkpoint)
 		("ext-chunk-size", 0, "chunk size for adaptive ranking (default=auto)", ext_chunk_size)
 		("no-ranking", 0, "disable ranking heuristic", no_ranking)
 		("culling-overlap", 0, "minimum range overlap with higher scoring hit to delete a hit (default=50%)", inner_culling_overlap, 50.0)
@@ -430,6 +439,8 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("tantan-minMaskProb", 0, "minimum repeat probability for masking (default=0.9)", tantan_minMaskProb, 0.9)
 		("file-buffer-size", 0, "file buffer size in bytes (default=67108864)", file_buffer_size, (size_t)67108864)
 		("no-unlink", 0, "Do not unlink temporary files.", no_unlink)
+		("mmap-db", 0, "Read .dmnd sequence data through a shared memory mapping", mmap_db)
+		("shared-db", 0, "Share loaded reference blocks with concurrent processes through POSIX shared memory", shared_db)
 		("target-indexed", 0, "Enable target-indexed mode", target_indexed)
 		("ignore-warnings", 0, "Ignore warnings", ignore_warnings)
 		("unaligned-targets", 0, "", unaligned_targets)
@@ -442,8 +453,13 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("log-evalue-scale", 0, "", log_evalue_scale, 1.0 / std::log(2.0))
 		("bootstrap", 0, "", bootstrap)
 		("mp-self", 0, "", mp_self)
+		("mp-split-min-seqs", 0, "", mp_split_min_seqs, (int64_t)1000)
 		("query-or-subject-cover", 0, "", query_or_target_cover);
 
+	auto& coordinator_opt = parser.add_group("Multiprocessing coordinator options", { blastp, blastx, MP_COORDINATOR });
+	coordinator_opt.add()
+		("mp-coordinator", 0, "address of the multiprocessing work queue coordinator (unix:PATH or HOST:PORT)", mp_coordinator);
+
 	auto& view_options = parser.add_group("View options", { view, blastp, blastx });
 	view_options.add()
 		("daa", 'a', "DIAMOND alignment archive (DAA) file", daa_file)
@@ -551,6 +567,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("col-bin", 0, "", col_bin, 400)
 		("self", 0, "", self)
 		("trace-pt-fetch-size", 0, "", trace_pt_fetch_size, (int64_t)10e9)
+		("output-backlog", 0, "", output_backlog, (int64_t)4e9)
 		("tile-size", 0, "", tile_size, (uint32_t)1024)
 		("short-query-ungapped-bitscore", 0, "", short_query_ungapped_bitscore, 25.0)
 		("short-query-max-len", 0, "", short_query_max_len, 60)
@@ -604,7 +621,6 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("bootstrap-block", 0, "", bootstrap_block, (int64_t)1000000)
 		("centroid-factor", 0, "", centroid_factor, (int64_t)3)
 		("timeout", 0, "", timeout)
-		("resume", 0, "", resume)
 		("target_hard_cap", 0, "", target_hard_cap)
 		("mapany", 0, "", mapany)
 		("neighbors", 0, "", neighbors)
@@ -633,7 +649,8 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("mcl-sparsity-switch", 0, "MCL switch to sparse matrix computation (default=0.8) ", cluster_mcl_sparsity_switch, 0.8)
 		("mcl-nonsymmetric", 0, "Do not symmetrize the transistion matrix before clustering", cluster_mcl_nonsymmetric)
 		("mcl-stats", 0, "Some stats about the connected components in MCL", cluster_mcl_stats)
-		("cluster-algo", 0, "Clustering algorithm (\"mcl\")", cluster_algo)
+		("mcl-prune-threshold", 0, "MCL prune matrix entries below this value after expansion (default=0)", cluster_mcl_prune_threshold, 0.0)
+		("mcl-prune-max", 0, "MCL maximum number of entries per column kept after expansion (default=0, unlimited)", cluster_mcl_prune_max, (uint32_t)0)
 		("approx-backtrace", 0, "", approx_backtrace)
 		("prefix-scan", 0, "", prefix_scan)
 		("narrow-band-cov", 0, "", narrow_band_cov)
@@ -646,7 +663,6 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("no_chaining_merge_hsps", 0, "", no_chaining_merge_hsps)
 		("no_recluster_bd", 0, "", no_recluster_bd)
 		("pipeline-short", 0, "", pipeline_short)
-		("graph-algo", 0, "", graph_algo, string("gvc"))
 #ifndef KEEP_TARGET_ID
 		("kmer-ranking", 0, "Rank sequences based on kmer frequency in linear stage", kmer_ranking)
 #endif
@@ -831,6 +847,13 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 	if (command == Config::blastp || command == Config::blastx || command == Config::blastn || command == Config::benchmark || command == Config::model_sim || command == Config::opt
 		|| command == Config::mask || command == Config::cluster || command == Config::compute_medoids || command == Config::regression_test || command == Config::CLUSTER_REASSIGN
 		|| command == Config::RECLUSTER || command == Config::DEEPCLUST) {
+		if ((command == Config::blastp || command == Config::blastx) && !resume.empty()) {
+			if (output_file.empty())
+				output_file = resume;
+			else if (output_file != resume)
+				throw std::runtime_error("--resume needs to specify the output file of the interrupted run.");
+			checkpoint = true;
+		}
 		if (tmpdir == "")
 			tmpdir = extract_dir(output_file);
 
@@ -894,6 +917,8 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 
 	if (parallel_tmpdir == "") {
 		parallel_tmpdir = tmpdir;
+		if (checkpoint && parallel_tmpdir.empty())
+			parallel_tmpdir = ".";
 	} else {
 #ifndef WIN32
 		if (multiprocessing) {
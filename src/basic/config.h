@@ -42,7 +42,7 @@ template<> struct EnumTraits<SequenceType> {
     static const SEMap<SequenceType> from_string;
 };
 
-enum class GraphAlgo { GREEDY_VERTEX_COVER, LEN_SORTED };
+enum class GraphAlgo { GREEDY_VERTEX_COVER, LEN_SORTED, CONNECTED_COMPONENTS };
 
 template<> struct EnumTraits<GraphAlgo> {
 	static const SEMap<GraphAlgo> from_string;
@@ -161,6 +161,7 @@ struct Config
 	double transcript_len_estimate;
 	string family_counts_file;
 	string taxonlist;
+	bool taxon_index;
 	bool radix_cluster_buffered;
 	unsigned join_split_size;
 	unsigned join_split_key_len;
@@ -185,6 +186,8 @@ struct Config
 	double tantan_r;
 	double tantan_minMaskProb;
 	bool no_unlink;
+	bool mmap_db;
+	bool shared_db;
 	bool no_dict;
 	int stop_match_score;
 	int tantan_maxRepeatOffset;
@@ -223,6 +226,7 @@ struct Config
 	size_t file_buffer_size;
 	bool self;
 	int64_t trace_pt_fetch_size;
+	int64_t output_backlog;
 	uint32_t tile_size;
 	double short_query_ungapped_bitscore;
 	int short_query_max_len;
@@ -287,6 +291,7 @@ struct Config
 	double chaining_stacked_hsp_ratio;
 	Option<double> cluster_threshold;
 	Option<string> memory_limit;
+	Option<string> seed_cache_size;
 	int64_t swipe_task_size;
 	Loc minimizer_window_;
 	bool lin_stage1;
@@ -298,6 +303,7 @@ struct Config
 	int64_t centroid_factor;
 	int timeout;
 	string resume;
+	string cluster_update;
 	int64_t target_hard_cap;
 	bool mapany;
 	Option<string> clustering;
@@ -343,16 +349,19 @@ struct Config
 	Sensitivity sensitivity;
 
 	bool multiprocessing;
+	string mp_coordinator;
+	int64_t mp_split_min_seqs;
 	bool mp_init;
 	bool mp_recover;
 	int mp_query_chunk;
+	bool checkpoint;
 
 	enum {
 		makedb = 0, blastp = 1, blastx = 2, view = 3, help = 4, version = 5, getseq = 6, benchmark = 7, random_seqs = 8, compare = 9, sort = 10, roc = 11, db_stat = 12, model_sim = 13,
 		match_file_stat = 14, model_seqs = 15, opt = 16, mask = 17, fastq2fasta = 18, dbinfo = 19, test_extra = 20, test_io = 21, db_annot_stats = 22, read_sim = 23, info = 24, seed_stat = 25,
 		smith_waterman = 26, cluster = 27, translate = 28, filter_blasttab = 29, show_cbs = 30, simulate_seqs = 31, split = 32, upgma = 33, upgma_mc = 34, regression_test = 35,
 		reverse_seqs = 36, compute_medoids = 37, mutate = 38, rocid = 40, makeidx = 41, find_shapes, prep_db, composition, JOIN, HASH_SEQS, LIST_SEEDS, CLUSTER_REALIGN,
-		GREEDY_VERTEX_COVER, INDEX_FASTA, FETCH_SEQ, CLUSTER_REASSIGN, blastn, RECLUSTER, LENGTH_SORT, MERGE_DAA, DEEPCLUST
+		GREEDY_VERTEX_COVER, INDEX_FASTA, FETCH_SEQ, CLUSTER_REASSIGN, blastn, RECLUSTER, LENGTH_SORT, MERGE_DAA, DEEPCLUST, MP_COORDINATOR
 	};
 	unsigned	command;
 
@@ -374,6 +383,8 @@ struct Config
 	uint32_t cluster_mcl_max_iter;
 	bool cluster_mcl_stats;
 	bool cluster_mcl_nonsymmetric;
+	double cluster_mcl_prune_threshold;
+	uint32_t cluster_mcl_prune_max;
 
 	enum { query_parallel = 0, target_parallel = 1 };
 	unsigned load_balancing;
@@ -410,6 +421,8 @@ struct Config
 	std::string single_query_file() const;
 
 	bool mem_buffered() const { return tmpdir == "/dev/shm"; }
+	// Reference block outputs and dictionaries are written to named files in parallel_tmpdir.
+	bool persistent_ref_blocks() const { return multiprocessing || checkpoint; }
 	Compressor compressor() const;
 
   	template<typename _t>
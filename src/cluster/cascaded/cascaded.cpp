@@ -24,6 +24,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/algo/algo.h"
 #include "../../basic/statistics.h"
 #include "../../run/workflow.h"
+#include "../../search/seed_index_cache.h"
+#include "../../search/search.h"
+#include "../../basic/shape_config.h"
 
 const char* const DEFAULT_MEMORY_LIMIT = "16G";
 
@@ -38,6 +41,7 @@ using std::tie;
 using std::string;
 using std::pair;
 using std::iota;
+using std::set;
 
 namespace Cluster {
 
@@ -54,7 +58,6 @@ static BitVector rep_bitset(const vector<SuperBlockId> &centroid, const BitVecto
 }
 
 vector<SuperBlockId> cluster(shared_ptr<SequenceFile>& db, const shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, bool last_round) {
-	using Edge = Util::Algo::Edge<SuperBlockId>;
 	statistics.reset();
 	config.command = Config::blastp;
 	config.output_format = { "edge" };
@@ -66,28 +69,37 @@ vector<SuperBlockId> cluster(shared_ptr<SequenceFile>& db, const shared_ptr<BitV
 	config.self = true;
 	config.iterate.unset();
 	config.mapany = false;
-	tie(config.chunk_size, config.lowmem_) = block_size(Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)), config.sensitivity, config.lin_stage1);
-
-	shared_ptr<Callback> callback(new Callback);
 
+	const auto algo = from_string<GraphAlgo>(config.graph_algo);
+	std::unique_ptr<ConcurrentDisjointSet<SuperBlockId>> components;
+	if (algo == GraphAlgo::CONNECTED_COMPONENTS)
+		components.reset(new ConcurrentDisjointSet<SuperBlockId>((SuperBlockId)db->sequence_count()));
+	const int64_t search_mem = Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)) - (components ? 0 : edge_buffer_size());
+	tie(config.chunk_size, config.lowmem_) = block_size(search_mem, config.sensitivity, config.lin_stage1);
+	shared_ptr<Callback> callback(new Callback(components.get()));
+
+	if (Search::seed_index_cache)
+		Search::seed_index_cache->begin_search(db.get(), filter.get());
 	Search::run(db, nullptr, callback, filter);
+	if (Search::seed_index_cache)
+		Search::seed_index_cache->end_search();
 
 	message_stream << "Finished search. #Edges: " << callback->count << endl;
-	task_timer timer("Allocating buffers");
-	vector<Edge> edges(callback->count);
-	timer.go("Loading edges");
-	InputFile f(callback->edge_file);
-	f.read(edges.data(), callback->count);
-	f.close_and_delete();
-	timer.go("Sorting edges");
 	db->reopen();
-	FlatArray<Edge> edge_array = make_flat_array_dense(move(edges), (SuperBlockId)db->sequence_count(), config.threads_, Edge::GetKey());
+	return cluster_graph(*callback, (SuperBlockId)db->sequence_count(), member_counts, last_round);
+}
+
+vector<SuperBlockId> cluster_graph(Callback& callback, SuperBlockId node_count, const SuperBlockId* member_counts, bool last_round) {
+	using Edge = Util::Algo::Edge<SuperBlockId>;
+	if (callback.components)
+		return callback.components->roots();
+	if (from_string<GraphAlgo>(config.graph_algo) == GraphAlgo::LEN_SORTED)
+		return len_sorted_clust(callback.edges, node_count);
+	task_timer timer("Loading edges");
+	FlatArray<Edge> edge_array = callback.edges.flat_array(node_count);
 	timer.finish();
 
-	const auto algo = from_string<GraphAlgo>(config.graph_algo);
-	return algo == GraphAlgo::GREEDY_VERTEX_COVER ?
-		Util::Algo::greedy_vertex_cover(edge_array, config.weighted_gvc ? member_counts : nullptr, last_round && !config.strict_gvc)
-		: len_sorted_clust(edge_array);
+	return Util::Algo::greedy_vertex_cover(edge_array, config.weighted_gvc ? member_counts : nullptr, last_round && !config.strict_gvc);
 }
 
 static pair<vector<SuperBlockId>, BitVector> update_clustering(const BitVector& previous_filter, const vector<SuperBlockId>& previous_centroids, vector<SuperBlockId>&& current_centroids, int round) {
@@ -99,6 +111,25 @@ static pair<vector<SuperBlockId>, BitVector> update_clustering(const BitVector&
 	return { current_centroids, oid_filter };
 }
 
+// Returns the ids of the seed shapes that a step shares with an earlier step. Only these are worth caching.
+static set<string> reused_shapes(const vector<string>& steps) {
+	set<string> seen, reused;
+	for (const string& step : steps) {
+		if (step == KMER_GROUPING_STEP || ends_with(step, "_lin"))
+			continue;
+		const Sensitivity sens = from_string<Sensitivity>(step);
+		const int minimizer_window = config.minimizer_window_ ? config.minimizer_window_ : Search::sensitivity_traits[(int)align_mode.sequence_type].at(sens).minimizer_window;
+		const ShapeConfig shape_cfg(config.shape_mask.empty() ? Search::shape_codes[(int)align_mode.sequence_type].at(sens) : config.shape_mask, config.shapes);
+		set<string> ids;
+		for (unsigned i = 0; i < shape_cfg.count(); ++i)
+			ids.insert(Search::SeedIndexCache::shape_id(shape_cfg[i], minimizer_window));
+		for (const string& id : ids)
+			if (!seen.insert(id).second)
+				reused.insert(id);
+	}
+	return reused;
+}
+
 vector<SuperBlockId> cascaded(shared_ptr<SequenceFile>& db) {
 	if (db->sequence_count() > (int64_t)numeric_limits<SuperBlockId>::max())
 		throw runtime_error("Workflow supports a maximum of " + to_string(numeric_limits<SuperBlockId>::max()) + " input sequences.");
@@ -107,19 +138,30 @@ vector<SuperBlockId> cascaded(shared_ptr<SequenceFile>& db) {
 	int64_t cluster_count = db->sequence_count();
 	vector<SuperBlockId> centroids(cluster_count);
 	iota(centroids.begin(), centroids.end(), 0);
+	// Reference seed arrays of shapes used again by a later round are kept, by default within 1/8 of the memory limit.
+	const int64_t cache_size = config.seed_cache_size.present() ? Util::String::interpret_number(config.seed_cache_size.get(""))
+		: Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)) / 8;
+	const set<string> reused = reused_shapes(steps);
+	if (cache_size > 0 && !reused.empty())
+		Search::seed_index_cache.reset(new Search::SeedIndexCache(cache_size, reused));
 
 	for (int i = 0; i < (int)steps.size(); i++) {
 		task_timer timer;
-		config.lin_stage1 = ends_with(steps[i], "_lin");
-		config.sensitivity = from_string<Sensitivity>(rstrip(steps[i], "_lin"));
+		const bool kmer_step = steps[i] == KMER_GROUPING_STEP;
+		if (!kmer_step) {
+			config.lin_stage1 = ends_with(steps[i], "_lin");
+			config.sensitivity = from_string<Sensitivity>(rstrip(steps[i], "_lin"));
+		}
+		auto f = kmer_step ? kmer_grouping : cluster;
 		tie(centroids, *oid_filter) = update_clustering(*oid_filter,
 			centroids,
-			cluster(db, i == 0 ? nullptr : oid_filter, config.weighted_gvc ? member_counts(centroids).data() : nullptr, i == (int)steps.size() - 1),
+			f(db, i == 0 ? nullptr : oid_filter, config.weighted_gvc ? member_counts(centroids).data() : nullptr, i == (int)steps.size() - 1),
 			i);
 		const int64_t n = oid_filter->one_count();
 		message_stream << "Clustering round " << i + 1 << " complete. #Input sequences: " << cluster_count << " #Clusters: " << n << " Time: " << timer.seconds() << 's' << endl;
 		cluster_count = n;
 	}
+	Search::seed_index_cache.reset();
 	return centroids;
 }
 	
@@ -18,6 +18,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include "../cluster.h"
+#include "../../util/data_structures/disjoint_set.h"
+#include "../../util/algo/edge_store.h"
 
 namespace Cluster { 
 
@@ -32,29 +34,72 @@ struct Cascaded : public ClusteringAlgorithm {
 
 std::vector<SuperBlockId> cascaded(std::shared_ptr<SequenceFile>& db);
 std::vector<std::string> cluster_steps(double approx_id);
+std::vector<SuperBlockId> kmer_grouping(std::shared_ptr<SequenceFile>& db, const std::shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, bool last_round);
 
+struct KmerEntry {
+	KmerEntry() {}
+	KmerEntry(uint64_t hash, Loc len, SuperBlockId oid) :
+		hash(hash),
+		len(len),
+		oid(oid)
+	{}
+	// Within a group of equal k-mers, the longest sequence comes first.
+	bool operator<(const KmerEntry& e) const {
+		return hash < e.hash || (hash == e.hash && (len > e.len || (len == e.len && oid < e.oid)));
+	}
+	uint64_t hash;
+	Loc len;
+	SuperBlockId oid;
+};
+
+// Returns the sketch k-mers of the sequences selected by the filter (all sequences if filter is nullptr).
+std::vector<KmerEntry> kmer_sketch(SequenceFile& db, const BitVector* filter);
+
+// Name of the cascaded step that groups sequences by shared k-mers instead of running a search.
+extern const char* const KMER_GROUPING_STEP;
+
+// Size of the in-memory edge buffer, which is taken from the memory limit of the search.
+inline int64_t edge_buffer_size() {
+	return Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)) / 4;
+}
+
+// Collects the edges in an edge store that spills to disk beyond edge_buffer_size(), or if components is set
+// merges their nodes directly, so that the connected components are available when the search ends.
 struct Callback : public Consumer {
 	using Edge = Util::Algo::Edge<SuperBlockId>;
-	Callback() :
-		count(0)
+	Callback(ConcurrentDisjointSet<SuperBlockId>* components = nullptr) :
+		edges(components ? 0 : edge_buffer_size()),
+		count(0),
+		components(components)
 	{}
 	virtual void consume(const char* ptr, size_t n) override {
 		const char* end = ptr + n;
 		while (ptr < end) {
 			const auto edge = *(Output::Format::Edge::Data*)ptr;
 			ptr += sizeof(Output::Format::Edge::Data);
+			if (components) {
+				if (edge.qcovhsp >= config.member_cover || edge.scovhsp >= config.member_cover) {
+					components->merge((SuperBlockId)edge.query, (SuperBlockId)edge.target);
+					++count;
+				}
+				continue;
+			}
 			if (edge.qcovhsp >= config.member_cover) {
-				edge_file.write(Edge((SuperBlockId)edge.target, (SuperBlockId)edge.query, edge.evalue));
+				edges.push(Edge((SuperBlockId)edge.target, (SuperBlockId)edge.query, edge.evalue));
 				++count;
 			}
 			if (edge.scovhsp >= config.member_cover) {
-				edge_file.write(Edge((SuperBlockId)edge.query, (SuperBlockId)edge.target, edge.evalue));
+				edges.push(Edge((SuperBlockId)edge.query, (SuperBlockId)edge.target, edge.evalue));
 				++count;
 			}
 		}
 	}
-	TempFile edge_file;
+	Util::Algo::EdgeStore<SuperBlockId> edges;
 	int64_t count;
+	ConcurrentDisjointSet<SuperBlockId>* components;
 };
 
+// Clusters the graph collected by the callback using the algorithm selected by --graph-algo.
+std::vector<SuperBlockId> cluster_graph(Callback& callback, SuperBlockId node_count, const SuperBlockId* member_counts, bool last_round);
+
 }
@@ -5,9 +5,14 @@ using std::vector;
 
 namespace Cluster {
 
+const char* const KMER_GROUPING_STEP = "linclust";
+
 vector<string> cluster_steps(double approx_id) {
-	if (!config.cluster_steps.empty())
+	if (!config.cluster_steps.empty()) {
+		if (config.cluster_steps.back() == KMER_GROUPING_STEP)
+			throw std::runtime_error("The k-mer grouping step (" + string(KMER_GROUPING_STEP) + ") cannot be the last clustering step.");
 		return config.cluster_steps;
+	}
 	vector<string> v = { "faster_lin", "fast" };
 	if (approx_id < 90)
 		v.push_back("default");
@@ -0,0 +1,145 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2022 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <mutex>
+#include "cascaded.h"
+#include "../../basic/config.h"
+#include "../../basic/reduction.h"
+#include "../../basic/statistics.h"
+#include "../../output/output_format.h"
+#include "../../util/kmer/kmer.h"
+#include "../../util/hash_function.h"
+#include "../../util/parallel/parallel_for.h"
+#include "../../lib/ips4o/ips4o.hpp"
+
+using std::vector;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::pair;
+using std::function;
+using std::mutex;
+using std::lock_guard;
+using std::endl;
+using std::tie;
+
+namespace Cluster {
+
+// Linclust-style grouping (doi:10.1038/s41467-018-04964-5): each sequence contributes the KMERS_PER_SEQ k-mers of
+// its reduced sequence with the smallest hash values. Sequences sharing a k-mer form a group and are aligned only
+// against the longest sequence of the group, so the number of alignments is linear in the input size.
+static const size_t KMER_LEN = 12;
+static const int KMERS_PER_SEQ = 20;
+static const char* const KMER_REDUCTION = "A KR EDNQ C G H ILVM FYW P ST";
+
+vector<KmerEntry> kmer_sketch(SequenceFile& db, const BitVector* filter) {
+	const Reduction reduction(KMER_REDUCTION);
+	const int64_t block_size = Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)) / 2;
+	vector<KmerEntry> kmers;
+	mutex mtx;
+	db.set_seqinfo_ptr(0);
+	for (;;) {
+		unique_ptr<Block> block(db.load_seqs(block_size, filter, SequenceFile::LoadFlags::SEQS | SequenceFile::LoadFlags::CONVERT_ALPHABET | SequenceFile::LoadFlags::NO_CLOSE_WEAKLY));
+		if (block->empty())
+			break;
+		parallel_for(block->seqs().size(), config.threads_, [&](int64_t begin, int64_t end) {
+			vector<KmerEntry> out;
+			vector<uint64_t> hashes;
+			for (int64_t i = begin; i < end; ++i) {
+				const Sequence seq = block->seqs()[i];
+				hashes.clear();
+				for (KmerIterator<KMER_LEN, Reduction> it(seq, reduction); it.good(); ++it)
+					hashes.push_back(MurmurHash()(*it));
+				const auto n = std::min(hashes.size(), (size_t)KMERS_PER_SEQ);
+				std::partial_sort(hashes.begin(), hashes.begin() + n, hashes.end());
+				const SuperBlockId oid = (SuperBlockId)block->block_id2oid(i);
+				for (auto j = hashes.cbegin(); j < hashes.cbegin() + n; ++j)
+					if (j == hashes.cbegin() || *j != *(j - 1))
+						out.emplace_back(*j, seq.length(), oid);
+			}
+			lock_guard<mutex> lock(mtx);
+			kmers.insert(kmers.end(), out.begin(), out.end());
+		});
+	}
+	return kmers;
+}
+
+// Returns the (representative, member) pairs of the k-mer groups, sorted and without duplicates.
+static vector<pair<OId, OId>> group_pairs(vector<KmerEntry>& kmers) {
+	ips4o::parallel::sort(kmers.begin(), kmers.end(), std::less<KmerEntry>(), config.threads_);
+	vector<pair<OId, OId>> pairs;
+	for (auto i = kmers.cbegin(); i < kmers.cend();) {
+		auto j = i + 1;
+		for (; j < kmers.cend() && j->hash == i->hash; ++j)
+			if (j->oid != i->oid)
+				pairs.emplace_back(i->oid, j->oid);
+		i = j;
+	}
+	ips4o::parallel::sort(pairs.begin(), pairs.end(), std::less<pair<OId, OId>>(), config.threads_);
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+	return pairs;
+}
+
+vector<SuperBlockId> kmer_grouping(shared_ptr<SequenceFile>& db, const shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, bool last_round) {
+	statistics.reset();
+	config.command = Config::blastp;
+	config.query_or_target_cover = config.member_cover;
+
+	task_timer timer("Selecting k-mers");
+	vector<KmerEntry> kmers = kmer_sketch(*db, filter.get());
+	timer.go("Grouping sequences");
+	vector<pair<OId, OId>> pairs = group_pairs(kmers);
+	vector<KmerEntry>().swap(kmers);
+	FlatArray<OId> groups;
+	vector<OId> reps;
+	tie(groups, reps) = make_flat_array(pairs.begin(), pairs.end(), config.threads_);
+	vector<pair<OId, OId>>().swap(pairs);
+	timer.finish();
+	message_stream << "#Groups: " << reps.size() << " #Alignments: " << groups.data_size() << endl;
+
+	const auto algo = from_string<GraphAlgo>(config.graph_algo);
+	unique_ptr<ConcurrentDisjointSet<SuperBlockId>> components;
+	if (algo == GraphAlgo::CONNECTED_COMPONENTS)
+		components.reset(new ConcurrentDisjointSet<SuperBlockId>((SuperBlockId)db->sequence_count()));
+	Callback callback(components.get());
+	Output::Format::Edge format;
+	TextBuffer buf;
+	const double approx_min_id = config.approx_min_id.get(0.0);
+	function<void(const HspContext&)> f([&](const HspContext& h) {
+		if (h.evalue() > config.max_evalue || h.approx_id() < approx_min_id)
+			return;
+		Output::Info info{ SeqInfo(), false, nullptr, buf, {} };
+		format.print_match(h, info);
+		callback.consume(buf.data(), buf.size());
+		buf.clear();
+	});
+
+	if (flag_any(db->format_flags(), SequenceFile::FormatFlags::TITLES_LAZY))
+		db->init_random_access(0, 0, false);
+	HspValues hsp_values = HspValues::COORDS;
+	if (approx_min_id > 0)
+		hsp_values |= HspValues::IDENT | HspValues::LENGTH;
+	realign(groups, reps, *db, f, hsp_values);
+	db->reopen();
+
+	message_stream << "#Edges: " << callback.count << endl;
+	return cluster_graph(callback, (SuperBlockId)db->sequence_count(), member_counts, last_round);
+}
+
+}
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../dp/flags.h"
 #include "../output/output_format.h"
 #include "../util/algo/algo.h"
+#include "../util/algo/edge_store.h"
 
 class ClusteringAlgorithm {
 public:
@@ -60,6 +61,7 @@ std::vector<SuperBlockId> member_counts(const std::vector<SuperBlockId>& mapping
 Util::Tsv::File* open_out_tsv();
 void init_thresholds();
 std::vector<BlockId> len_sorted_clust(const FlatArray<Util::Algo::Edge<SuperBlockId>>& edges);
+std::vector<BlockId> len_sorted_clust(Util::Algo::EdgeStore<SuperBlockId>& edges, SuperBlockId node_count);
 
 template<typename Int, typename Int2>
 std::vector<Int2> convert_mapping(const std::vector<Int>& mapping, Int2) {
@@ -1,4 +1,6 @@
 #include <fstream>
+#include <atomic>
+#include <limits>
 #include "cluster.h"
 #include "../util/tsv/tsv.h"
 #include "../util/string/tokenizer.h"
@@ -6,6 +8,8 @@
 #include "../search/search.h"
 #define _REENTRANT
 #include "../lib/ips4o/ips4o.hpp"
+#include "../util/parallel/parallel_for.h"
+#include "../util/algo/external_sort.h"
 
 const char* const HEADER_LINE = "centroid\tmember";
 
@@ -115,25 +119,51 @@ void output(File& out, SequenceFile& db, File& oid_to_centroid_oid) {
 	join(*sorted2, db.seqid_file(), 0, 0, { {1,1}, {0,1} }, out);
 }
 
-template<typename Int>
-void output_mem(File& out, SequenceFile& db, const FlatArray<Int>& clusters, const vector<Int>& centroids) {
-	const Util::Tsv::Table acc_mapping = db.seqid_file().read(config.threads_);
-	for (Int i = 0; i < (Int)centroids.size(); ++i) {
-		const string centroid = acc_mapping[centroids[i]].template get<string>(0);
-		for(auto j = clusters.cbegin(i); j != clusters.cend(i); ++j)
-			out.write_record(centroid, acc_mapping[*j].template get<string>(0));
-	}
-}
-
-template void output_mem<int32_t>(File&, SequenceFile&, const FlatArray<int32_t>&, const vector<int32_t>&);
-template void output_mem<int64_t>(File&, SequenceFile&, const FlatArray<int64_t>&, const vector<int64_t>&);
+// Number of sequence ids read or output records written at a time.
+static const int64_t OUTPUT_CHUNK = 1 << 16;
 
+// Writes the clustering without holding the sequence ids in memory: the (centroid, member) pairs are sorted
+// externally together with the member ids, which a sequential scan of the id list resolves in oid order. A second
+// scan resolves the centroid ids, which the sorted pairs request in ascending order. Sequences mapped to -1 are skipped.
 template<typename Int>
 void output_mem(File& out, SequenceFile& db, const vector<Int>& mapping) {
-	vector<Int> centroids;
-	FlatArray<Int> clusters;
-	tie(clusters, centroids) = cluster_sorted(mapping);
-	output_mem<Int>(out, db, clusters, centroids);
+	using Entry = pair<pair<Int, Int>, string>;
+	ExternalSorter<Entry> sorter;
+	File& ids = db.seqid_file();
+	for (Int oid = 0; oid < (Int)mapping.size();) {
+		const Table chunk = ids.read(OUTPUT_CHUNK, config.threads_);
+		if (chunk.empty())
+			throw runtime_error("Premature end of sequence id list.");
+		for (int64_t i = 0; i < chunk.size() && oid < (Int)mapping.size(); ++i, ++oid)
+			if (mapping[oid] >= 0)
+				sorter.push({ { mapping[oid], oid }, chunk[i].template get<string>(0) });
+	}
+	sorter.init_read();
+
+	File& centroid_ids = db.seqid_file();
+	Table chunk(centroid_ids.schema()), buf(out.schema());
+	Int chunk_begin = 0, centroid = -1;
+	string centroid_id, line;
+	for (; sorter.good(); ++sorter) {
+		const Entry& e = *sorter;
+		if (e.first.first != centroid) {
+			centroid = e.first.first;
+			while (centroid >= chunk_begin + (Int)chunk.size()) {
+				chunk_begin += (Int)chunk.size();
+				chunk = centroid_ids.read(OUTPUT_CHUNK, config.threads_);
+				if (chunk.empty())
+					throw runtime_error("Premature end of sequence id list.");
+			}
+			centroid_id = chunk[centroid - chunk_begin].template get<string>(0);
+		}
+		line = centroid_id + '\t' + e.second;
+		buf.push_back(line.cbegin(), line.cend());
+		if (buf.size() >= OUTPUT_CHUNK) {
+			out.write(buf);
+			buf = Table(out.schema());
+		}
+	}
+	out.write(buf);
 }
 
 template void output_mem<int32_t>(File&, SequenceFile&, const vector<int32_t>&);
@@ -143,10 +173,11 @@ template<typename Int>
 void output_mem(File& out, SequenceFile& db, File& oid_to_centroid_oid) {
 	vector<pair<Int, Int>> centroid_oid;
 	oid_to_centroid_oid.template read<Int, Int>(back_inserter(centroid_oid));
-	vector<Int> centroids;
-	FlatArray<Int> clusters;
-	tie(clusters, centroids) = make_flat_array(centroid_oid.begin(), centroid_oid.end(), config.threads_);
-	output_mem<Int>(out, db, clusters, centroids);
+	vector<Int> mapping(db.sequence_count(), -1);
+	for (const pair<Int, Int>& p : centroid_oid)
+		mapping[p.second] = p.first;
+	vector<pair<Int, Int>>().swap(centroid_oid);
+	output_mem<Int>(out, db, mapping);
 }
 
 void output_mem(File& out, SequenceFile& db, File& oid_to_centroid_oid) {
@@ -204,15 +235,76 @@ File* open_out_tsv() {
 	return file;
 }
 
+// Node i becomes a centroid unless a centroid j < i has an edge to it, members are assigned to the first such centroid.
+// Nodes are processed in windows: within a window, the decisions are made sequentially using only the edges that point
+// into the window (edge lists are sorted by node2), then the edges of the window's centroids that point beyond it are
+// applied in parallel as an atomic minimum. This gives the same result as processing all nodes sequentially.
 vector<BlockId> len_sorted_clust(const FlatArray<Util::Algo::Edge<SuperBlockId>>& edges) {
-	vector<BlockId> v(edges.size(), -1);
-	for (int64_t i = 0; i < edges.size(); ++i) {
-		if (v[i] != -1)
+	using Edge = Util::Algo::Edge<SuperBlockId>;
+	const int64_t n = edges.size(), window = std::max((int64_t)1 << 16, n / 4096);
+	const BlockId none = std::numeric_limits<BlockId>::max();
+	vector<std::atomic<BlockId>> v(n);
+	parallel_for(n, config.threads_, [&](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i)
+			v[i].store(none, std::memory_order_relaxed);
+	});
+	const auto node2_less = [](const Edge& e, int64_t node) { return e.node2 < node; };
+	vector<BlockId> centroids;
+	for (int64_t w = 0; w < n; w += window) {
+		const int64_t w_end = std::min(w + window, n);
+		centroids.clear();
+		for (int64_t i = w; i < w_end; ++i) {
+			if (v[i].load(std::memory_order_relaxed) != none)
+				continue;
+			v[i].store((BlockId)i, std::memory_order_relaxed);
+			centroids.push_back((BlockId)i);
+			auto it = std::lower_bound(edges.cbegin(i), edges.cend(i), i + 1, node2_less);
+			for (; it != edges.cend(i) && it->node2 < w_end; ++it)
+				if (v[it->node2].load(std::memory_order_relaxed) == none)
+					v[it->node2].store((BlockId)i, std::memory_order_relaxed);
+		}
+		parallel_for((int64_t)centroids.size(), config.threads_, [&](int64_t begin, int64_t end) {
+			for (int64_t j = begin; j < end; ++j) {
+				const BlockId c = centroids[j];
+				for (auto it = std::lower_bound(edges.cbegin(c), edges.cend(c), w_end, node2_less); it != edges.cend(c); ++it) {
+					BlockId x = v[it->node2].load(std::memory_order_relaxed);
+					while (c < x && !v[it->node2].compare_exchange_weak(x, c, std::memory_order_relaxed));
+				}
+			}
+		});
+	}
+	vector<BlockId> r(n);
+	parallel_for(n, config.threads_, [&](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i)
+			r[i] = v[i].load(std::memory_order_relaxed);
+	});
+	return r;
+}
+
+// Same result as above, but streams the edges from the store if they were spilled to disk.
+vector<BlockId> len_sorted_clust(Util::Algo::EdgeStore<SuperBlockId>& edges, SuperBlockId node_count) {
+	if (!edges.spilled()) {
+		task_timer timer("Sorting edges");
+		const FlatArray<Util::Algo::Edge<SuperBlockId>> a = edges.flat_array(node_count);
+		timer.finish();
+		return len_sorted_clust(a);
+	}
+	task_timer timer("Merging edges");
+	edges.init_read();
+	vector<BlockId> v(node_count, -1);
+	vector<Util::Algo::Edge<SuperBlockId>> adj;
+	bool more = edges.next(adj);
+	for (SuperBlockId i = 0; i < node_count; ++i) {
+		const bool centroid = v[i] == -1;
+		if (centroid)
+			v[i] = i;
+		if (!more || adj.front().node1 != i)
 			continue;
-		v[i] = i;
-		for (auto it = edges.cbegin(i); it != edges.cend(i); ++it)
-			if (v[it->node2] == -1)
-				v[it->node2] = i;
+		if (centroid)
+			for (const auto& e : adj)
+				if (v[e.node2] == -1)
+					v[e.node2] = i;
+		more = edges.next(adj);
 	}
 	return v;
 }
@@ -30,7 +30,7 @@ struct Config {
 
 	void status_msg();
 	void save_state();
-	void load_state();
+	void load_state(const std::string& prefix);
 };
 
 }}
\ No newline at end of file
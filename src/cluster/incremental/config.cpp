@@ -1,4 +1,5 @@
 #include <fstream>
+#include <stdexcept>
 #include "common.h"
 #include "../../output/output_format.h"
 #include "../cluster.h"
@@ -7,6 +8,26 @@ using std::endl;
 
 namespace Cluster { namespace Incremental {
 
+// With --update, the centroids of the previous run are copied to the new output prefix and extended there.
+static FastaFile* open_centroids() {
+	if (!config.cluster_update.empty()) {
+		const std::string file_name = config.output_file + ".centroids.faa";
+		if (file_name == config.cluster_update + ".centroids.faa")
+			throw std::runtime_error("--update requires a different output file than the previous run.");
+		std::ifstream in(config.cluster_update + ".centroids.faa", std::ios::binary);
+		if (!in.good())
+			throw std::runtime_error("Centroid file of previous run not found: " + config.cluster_update + ".centroids.faa");
+		std::ofstream out(file_name, std::ios::binary);
+		out << in.rdbuf();
+		if (!out.good())
+			throw std::runtime_error("Error writing file: " + file_name);
+		out.close();
+		return new FastaFile(file_name, false, FastaFile::WriteAccess());
+	}
+	return config.resume.empty() ? new FastaFile(config.output_file + ".centroids.faa", true, FastaFile::WriteAccess())
+		: new FastaFile(config.resume + ".centroids.faa", false, FastaFile::WriteAccess());
+}
+
 Config::Config() :
 	message_stream(true),
 	verbosity(1),
@@ -14,8 +35,7 @@ Config::Config() :
 	block_size(config.chunk_size == 0.0 ? Search::sensitivity_traits[0].at(config.sensitivity).default_block_size : config.chunk_size),
 	output_format(init_output(-1)),
 	db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | SequenceFile::Flags::OID_TO_ACC_MAPPING)),
-	centroids(config.resume.empty() ? new FastaFile(config.output_file + ".centroids.faa", true, FastaFile::WriteAccess())
-	: new FastaFile(config.resume + ".centroids.faa", false, FastaFile::WriteAccess())),
+	centroids(open_centroids()),
 	output_file(open_out_tsv()),
 	seqs_processed(0),
 	letters_processed(0),
@@ -38,6 +58,7 @@ void Config::status_msg() {
 }
 
 void Config::save_state() {
+	centroids->init_write(); // flushes the centroids written since the last search
 	std::ofstream out1(config.output_file + ".oid2centroid");
 	for (OId i = 0; i < db->tell_seq(); ++i)
 		out1 << oid2centroid[i] << endl;
@@ -46,16 +67,23 @@ void Config::save_state() {
 		out2 << i << endl;
 }
 
-void Config::load_state() {
-	std::ifstream in1(config.resume + ".oid2centroid");
+void Config::load_state(const std::string& prefix) {
+	std::ifstream in1(prefix + ".oid2centroid");
+	if (!in1.good())
+		throw std::runtime_error("Clustering state not found: " + prefix + ".oid2centroid");
 	int64_t n = 0;
 	CentroidId i;
-	while (in1 >> i)
+	while (in1 >> i) {
+		if (n >= (int64_t)oid2centroid.size())
+			throw std::runtime_error("The database contains less sequences than the clustering state " + prefix);
 		oid2centroid[n++] = i;
-	std::ifstream in2(config.resume + ".centroid2oid");
+	}
+	std::ifstream in2(prefix + ".centroid2oid");
 	OId oid;
 	while (in2 >> oid)
 		centroid2oid.push_back(oid);
+	if ((int64_t)centroid2oid.size() != centroids->sequence_count())
+		throw std::runtime_error("Clustering state " + prefix + " does not match its centroid file.");
 	this->message_stream << "Centroid count = " << centroid2oid.size() << endl;
 	this->message_stream << "Seeking to OId " << n << endl;
 	db->set_seqinfo_ptr(n);
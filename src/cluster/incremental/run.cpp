@@ -42,7 +42,6 @@ struct BestCentroid : public Consumer, public vector<OId> {
 };
 
 static void self_align(Block& block, Config& cfg) {
-	using Edge = Util::Algo::Edge<SuperBlockId>;
 	task_timer timer(("CLUSTER Searching " + std::to_string(block.seqs().size()) + " unaligned sequences").c_str(), cfg.message_stream);
 	shared_ptr<Callback> neighbors(new Callback());
 	shared_ptr<BlockWrapper> unaligned_wrapper(new BlockWrapper(block));
@@ -63,17 +62,7 @@ static void self_align(Block& block, Config& cfg) {
 		timer.go("CLUSTER Computing clustering");
 
 	message_stream << "Finished search. #Edges: " << neighbors->count << endl;
-	timer.go("Allocating buffers");
-	vector<Edge> edges(neighbors->count);
-	timer.go("Loading edges");
-	InputFile f(neighbors->edge_file);
-	f.read(edges.data(), neighbors->count);
-	f.close_and_delete();
-	timer.go("Sorting edges");
-	FlatArray<Edge> edge_array = make_flat_array_dense(move(edges), n, config.threads_, Edge::GetKey());
-	timer.finish();
-
-	vector<BlockId> c = len_sorted_clust(edge_array); //Util::Algo::greedy_vertex_cover(edge_array, nullptr, false);
+	vector<BlockId> c = len_sorted_clust(neighbors->edges, (SuperBlockId)n);
 
 	cfg.centroids->init_write();
 	int64_t new_centroids = 0;
@@ -144,14 +133,17 @@ void Algo::run() {
 	config.database.require();	
 	Config cfg;
 	config.db_size = cfg.db->letters();
-	if (!config.resume.empty())
-		cfg.load_state();
+	if (!config.cluster_update.empty())
+		cfg.load_state(config.cluster_update);
+	else if (!config.resume.empty())
+		cfg.load_state(config.resume);
+	const bool bootstrap = config.resume.empty() && config.cluster_update.empty();
 	
 	task_timer timer("CLUSTER Opening the input file", cfg.message_stream);
 	const int64_t block_size = (int64_t)(cfg.block_size * 1e9), cache_limit = 0; // block_size;
 	config.output_format = { "edge" };
 	unique_ptr<Block> block;
-	if (config.resume.empty()) {
+	if (bootstrap) {
 		block.reset(cfg.db->load_seqs(std::min(block_size, config.bootstrap_block)));
 		cfg.seqs_processed += block->seqs().size();
 		cfg.letters_processed += block->seqs().letters();
@@ -185,7 +177,6 @@ void Algo::run() {
 
 		if (config.timeout && cfg.total_time.seconds() >= config.timeout) {
 			cfg.message_stream << "Timeout reached. Next OId = " << cfg.db->tell_seq() << endl;
-			cfg.save_state();
 			break;
 		}
 	}
@@ -196,6 +187,11 @@ void Algo::run() {
 			search_vs_centroids(*cfg.cache[i], i + 1, cfg);
 		}
 
+	if (!config.output_file.empty()) {
+		timer.go("Saving clustering state");
+		cfg.save_state();
+	}
+
 	timer.go("Generating output");
 	//const Groups groups = Util::Algo::sort_by_value(cfg.oid2centroid.cbegin(), cfg.oid2centroid.cend(), config.threads_);
 	//TextBuffer buf;
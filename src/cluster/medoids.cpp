@@ -0,0 +1,209 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2022 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <float.h>
+#include <mutex>
+#include "../basic/config.h"
+#include "../util/log_stream.h"
+#include "cluster.h"
+#include "../basic/statistics.h"
+#include "../stats/score_matrix.h"
+#include "../util/parallel/parallel_for.h"
+#include "../lib/ips4o/ips4o.hpp"
+#include "cascaded/cascaded.h"
+
+using std::endl;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+using std::pair;
+using std::tie;
+using std::function;
+using std::mutex;
+using std::lock_guard;
+
+namespace Cluster {
+
+// The medoid of a cluster is the member with the highest sum of bit scores against the other members. Only the
+// current centroid and the members that share the most sketch k-mers with their cluster (MEDOID_CANDIDATES in total)
+// are aligned, and only against an evenly spaced sample of at most MEDOID_SAMPLE members, which bounds the alignment
+// work per cluster.
+static const int64_t MEDOID_CANDIDATES = 16;
+static const int64_t MEDOID_SAMPLE = 1024;
+
+struct ClusterKmer {
+	ClusterKmer() {}
+	ClusterKmer(OId centroid, uint64_t hash, OId oid) :
+		centroid(centroid),
+		hash(hash),
+		oid(oid)
+	{}
+	bool operator<(const ClusterKmer& k) const {
+		return centroid < k.centroid || (centroid == k.centroid && hash < k.hash);
+	}
+	OId centroid;
+	uint64_t hash;
+	OId oid;
+};
+
+// Returns for each sequence the number of sketch k-mers it shares with other members of its cluster, and its length.
+static pair<vector<int32_t>, vector<Loc>> kmer_scores(SequenceFile& db, const vector<OId>& member2centroid) {
+	vector<KmerEntry> sketch = kmer_sketch(db, nullptr);
+	vector<ClusterKmer> kmers;
+	kmers.reserve(sketch.size());
+	vector<Loc> len(member2centroid.size(), 0);
+	for (const KmerEntry& k : sketch) {
+		kmers.emplace_back(member2centroid[k.oid], k.hash, k.oid);
+		len[k.oid] = k.len;
+	}
+	vector<KmerEntry>().swap(sketch);
+	ips4o::parallel::sort(kmers.begin(), kmers.end(), std::less<ClusterKmer>(), config.threads_);
+	vector<int32_t> scores(member2centroid.size(), 0);
+	for (auto i = kmers.cbegin(); i < kmers.cend();) {
+		auto j = i + 1;
+		while (j < kmers.cend() && j->centroid == i->centroid && j->hash == i->hash)
+			++j;
+		for (auto k = i; k < j; ++k)
+			scores[k->oid] += int32_t(j - i - 1);
+		i = j;
+	}
+	return { scores, len };
+}
+
+// Returns the (candidate, cluster index) pairs, sorted by candidate. The current centroid of a cluster is always a
+// candidate, the others are the members with the highest k-mer scores.
+static vector<pair<OId, int64_t>> select_candidates(const FlatArray<OId>& clusters, const vector<OId>& centroids, const vector<int32_t>& scores, const vector<Loc>& len) {
+	vector<pair<OId, int64_t>> candidates;
+	mutex mtx;
+	parallel_for(clusters.size(), config.threads_, [&](int64_t begin, int64_t end) {
+		vector<pair<OId, int64_t>> out;
+		vector<OId> members;
+		for (int64_t i = begin; i < end; ++i) {
+			members.assign(clusters.cbegin(i), clusters.cend(i));
+			const auto centroid = std::find(members.begin(), members.end(), centroids[i]);
+			if (centroid != members.end())
+				std::iter_swap(members.begin(), centroid);
+			const int64_t first = centroid != members.end() ? 1 : 0, n = std::min((int64_t)members.size(), MEDOID_CANDIDATES);
+			std::partial_sort(members.begin() + first, members.begin() + n, members.end(), [&](OId a, OId b) {
+				return scores[a] > scores[b] || (scores[a] == scores[b] && (len[a] > len[b] || (len[a] == len[b] && a < b)));
+			});
+			for (auto j = members.cbegin(); j < members.cbegin() + n; ++j)
+				out.emplace_back(*j, i);
+		}
+		lock_guard<mutex> lock(mtx);
+		candidates.insert(candidates.end(), out.begin(), out.end());
+	});
+	ips4o::parallel::sort(candidates.begin(), candidates.end(), std::less<pair<OId, int64_t>>(), config.threads_);
+	return candidates;
+}
+
+// Aligns the candidates against the member samples of their clusters and returns their bit score sums.
+static vector<double> candidate_scores(SequenceFile& db, const FlatArray<OId>& clusters, const vector<pair<OId, int64_t>>& candidates) {
+	vector<OId> query;
+	FlatArray<OId> targets;
+	query.reserve(candidates.size());
+	for (const pair<OId, int64_t>& c : candidates) {
+		query.push_back(c.first);
+		targets.next();
+		const int64_t n = clusters.count(c.second), sample = std::min(n, MEDOID_SAMPLE);
+		for (int64_t j = 0; j < sample; ++j) {
+			const OId member = *(clusters.cbegin(c.second) + j * n / sample);
+			if (member != c.first)
+				targets.push_back(member);
+		}
+	}
+	vector<double> scores(candidates.size(), 0.0);
+	function<void(const HspContext&)> callback([&](const HspContext& h) {
+		const auto i = std::lower_bound(query.cbegin(), query.cend(), h.query_oid) - query.cbegin();
+		scores[i] += h.bit_score();
+	});
+	realign(targets, query, db, callback, HspValues::NONE);
+	return scores;
+}
+
+void compute_medoids() {
+	config.database.require();
+	config.clustering.require();
+
+	task_timer timer("Opening the database");
+	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | SequenceFile::Flags::ACC_TO_OID_MAPPING | SequenceFile::Flags::OID_TO_ACC_MAPPING, SequenceFile::Metadata()));
+	config.db_size = db->letters();
+	score_matrix.set_db_letters(config.db_size);
+	config.max_evalue = DBL_MAX;
+	timer.finish();
+	message_stream << "#Database sequences: " << db->sequence_count() << ", #Letters: " << db->letters() << endl;
+	unique_ptr<Util::Tsv::File> out(open_out_tsv());
+
+	timer.go("Reading the input file");
+	vector<OId> member2centroid = read<OId>(config.clustering, *db);
+	FlatArray<OId> clusters;
+	vector<OId> centroids;
+	tie(clusters, centroids) = cluster_sorted(member2centroid);
+	timer.finish();
+	message_stream << "#Clusters: " << centroids.size() << endl;
+
+	timer.go("Computing k-mer scores");
+	vector<int32_t> kmer_score;
+	vector<Loc> len;
+	tie(kmer_score, len) = kmer_scores(*db, member2centroid);
+	timer.go("Selecting medoid candidates");
+	const vector<pair<OId, int64_t>> candidates = select_candidates(clusters, centroids, kmer_score, len);
+	vector<int32_t>().swap(kmer_score);
+	vector<Loc>().swap(len);
+	timer.finish();
+	message_stream << "#Medoid candidates: " << candidates.size() << endl;
+
+	if (flag_any(db->format_flags(), SequenceFile::FormatFlags::TITLES_LAZY))
+		db->init_random_access(0, 0, false);
+	statistics.reset();
+	const vector<double> scores = candidate_scores(*db, clusters, candidates);
+
+	timer.go("Assigning medoids");
+	// The centroid is kept unless another candidate scores strictly better.
+	vector<OId> medoids(centroids);
+	vector<double> best(centroids.size(), -1.0);
+	for (size_t i = 0; i < candidates.size(); ++i)
+		if (candidates[i].first == centroids[candidates[i].second])
+			best[candidates[i].second] = scores[i];
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		const int64_t c = candidates[i].second;
+		if (scores[i] > best[c]) {
+			best[c] = scores[i];
+			medoids[c] = candidates[i].first;
+		}
+	}
+	int64_t changed = 0;
+	for (int64_t i = 0; i < clusters.size(); ++i) {
+		if (medoids[i] != centroids[i])
+			++changed;
+		for (auto j = clusters.cbegin(i); j != clusters.cend(i); ++j)
+			member2centroid[*j] = medoids[i];
+	}
+	timer.finish();
+	message_stream << "#Clusters with changed representative: " << changed << endl;
+
+	timer.go("Generating output");
+	output_mem(*out, *db, member2centroid);
+
+	timer.go("Closing the database");
+	db.reset();
+}
+
+}
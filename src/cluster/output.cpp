@@ -64,15 +64,53 @@ struct Cfg {
 	shared_ptr<Block> centroid_block, member_block;
 };
 
-static void align_centroid(CentroidId centroid, ReorderQueue<TextBuffer*, OutputWriter>& out, Statistics& stats, ThreadPool& tp, Cfg& cfg) {
+// A piece of work: the members [begin, end) of a centroid that are contained in the member block.
+struct Piece {
+	CentroidId centroid;
+	FlatArray<OId>::DataConstIterator begin, end;
+};
+
+// Groups the centroids of the block into tasks of about swipe_task_size DP cells. Consecutive small clusters are
+// merged into one task and the members of large clusters are split over several tasks, so that the task size does
+// not depend on the cluster size distribution. Tasks are in centroid order, which keeps the output sorted.
+static FlatArray<Piece> schedule(CentroidId begin, const Cfg& cfg) {
+	FlatArray<Piece> tasks;
+	int64_t cells = 0;
+	bool open = false;
+	const auto add = [&](const Piece& piece) {
+		if (!open) {
+			tasks.next();
+			open = true;
+		}
+		tasks.push_back(piece);
+	};
+	for (CentroidId c = begin; c < (CentroidId)cfg.centroids.size() && cfg.centroids[c] < cfg.centroid_block->oid_end(); ++c) {
+		const int64_t centroid_len = cfg.centroid_block->seqs().length(cfg.centroid_block->oid2block_id(cfg.centroids[c]));
+		auto it = lower_bound(cfg.clusters.cbegin(c), cfg.clusters.cend(c), cfg.member_block->oid_begin());
+		const auto end = lower_bound(cfg.clusters.cbegin(c), cfg.clusters.cend(c), cfg.member_block->oid_end());
+		auto piece_begin = it;
+		for (; it != end; ++it) {
+			cells += centroid_len * cfg.member_block->seqs().length(cfg.member_block->oid2block_id(*it));
+			if (cells >= config.swipe_task_size) {
+				add(Piece{ c, piece_begin, it + 1 });
+				piece_begin = it + 1;
+				open = false;
+				cells = 0;
+			}
+		}
+		if (piece_begin != end)
+			add(Piece{ c, piece_begin, end });
+	}
+	return tasks;
+}
+
+static void align_piece(const Piece& piece, TextBuffer& buf, Statistics& stats, ThreadPool& tp, Cfg& cfg) {
 	DP::Targets dp_targets;
-	const OId centroid_oid = cfg.centroids[centroid];
+	const OId centroid_oid = cfg.centroids[piece.centroid];
 	const BlockId centroid_id = cfg.centroid_block->oid2block_id(centroid_oid);
 	const Sequence centroid_seq = cfg.centroid_block->seqs()[centroid_id];
-	auto begin = lower_bound(cfg.clusters.cbegin(centroid), cfg.clusters.cend(centroid), cfg.member_block->oid_begin());
-	auto end = lower_bound(cfg.clusters.cbegin(centroid), cfg.clusters.cend(centroid), cfg.member_block->oid_end());
 
-	for (auto it = begin; it != end; ++it) {
+	for (auto it = piece.begin; it != piece.end; ++it) {
 		const BlockId block_id = cfg.member_block->oid2block_id(*it);
 		const Sequence seq(cfg.member_block->seqs()[block_id]);
 		const int bin = DP::BandedSwipe::bin(cfg.hsp_values, centroid_seq.length(), 0, 0, (int64_t)seq.length() * (int64_t)centroid_seq.length(), 0, 0);
@@ -84,8 +122,7 @@ static void align_centroid(CentroidId centroid, ReorderQueue<TextBuffer*, Output
 	DP::Params p{ centroid_seq, centroid_seqid.c_str(), Frame(0), centroid_seq.length(), config.comp_based_stats == 1 ? cbs.int8.data() : nullptr, DP::Flags::FULL_MATRIX, cfg.hsp_values, stats, &tp };
 	list<Hsp> hsps = DP::BandedSwipe::swipe(dp_targets, p);
 
-	TextBuffer* buf = new TextBuffer;
-	TypeSerializer<HspContext> s(*buf);
+	TypeSerializer<HspContext> s(buf);
 	for (Hsp& hsp : hsps) {
 		s << HspContext(hsp,
 			centroid_id,
@@ -99,20 +136,24 @@ static void align_centroid(CentroidId centroid, ReorderQueue<TextBuffer*, Output
 			0,
 			Sequence());
 	}
-	out.push(centroid, buf);
 }
 
 static InputFile* run_block_pair(CentroidId begin, Cfg& cfg) {
-	atomic<CentroidId> next(begin);
+	const FlatArray<Piece> tasks = schedule(begin, cfg);
+	log_stream << "Realignment tasks = " << tasks.size() << endl;
+	atomic<int64_t> next(0);
 	TempFile out;
 	OutputWriter writer{ &out };
-	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(begin, writer));
+	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer, config.output_backlog));
 	auto worker = [&](ThreadPool& tp) {
 		Statistics stats;
-		CentroidId i = next++;
-		if (i >= (CentroidId)cfg.centroids.size() || cfg.centroids[i] >= cfg.centroid_block->oid_end())
+		const int64_t i = next++;
+		if (i >= tasks.size())
 			return false;
-		align_centroid(i, *output_sink, stats, tp, cfg);
+		TextBuffer* buf = new TextBuffer;
+		for (auto it = tasks.cbegin(i); it != tasks.cend(i); ++it)
+			align_piece(*it, *buf, stats, tp, cfg);
+		output_sink->push(i, buf);
 		statistics += stats;
 		return true;
 	};
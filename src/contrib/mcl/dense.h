@@ -89,6 +89,38 @@ void MCL::get_gamma(Eigen::MatrixXf* in, Eigen::MatrixXf* out, float r) {
 	dense_gamma_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
 }
 
+// Prunes the columns of a dense matrix after expansion in the same way as the sparse expansion kernel.
+static void prune_columns(Eigen::MatrixXf* m) {
+	const float threshold = (float)config.cluster_mcl_prune_threshold;
+	const Eigen::Index prune_max = config.cluster_mcl_prune_max;
+	const bool select = prune_max > 0 && prune_max < m->rows();
+	if (threshold <= 0.0f && !select)
+		return;
+	vector<float> values;
+	for (Eigen::Index icol = 0; icol < m->cols(); ++icol) {
+		if (threshold > 0.0f)
+			for (Eigen::Index irow = 0; irow < m->rows(); ++irow)
+				if (abs(m->coeffRef(irow, icol)) <= threshold)
+					m->coeffRef(irow, icol) = 0.0f;
+		if (!select)
+			continue;
+		values.clear();
+		for (Eigen::Index irow = 0; irow < m->rows(); ++irow)
+			values.push_back(abs(m->coeffRef(irow, icol)));
+		std::nth_element(values.begin(), values.begin() + prune_max - 1, values.end(), std::greater<float>());
+		const float min_value = values[prune_max - 1];
+		Eigen::Index kept = 0;
+		for (Eigen::Index irow = 0; irow < m->rows(); ++irow)
+			if (abs(m->coeffRef(irow, icol)) > min_value)
+				++kept;
+		for (Eigen::Index irow = 0; irow < m->rows(); ++irow) {
+			const float v = abs(m->coeffRef(irow, icol));
+			if (v < min_value || (v == min_value && kept++ >= prune_max))
+				m->coeffRef(irow, icol) = 0.0f;
+		}
+	}
+}
+
 void MCL::markov_process(Eigen::MatrixXf* m, float inflation, float expansion, uint32_t max_iter) {
 	uint32_t iteration = 0;
 	float diff_norm = numeric_limits<float>::max();
@@ -97,6 +129,7 @@ void MCL::markov_process(Eigen::MatrixXf* m, float inflation, float expansion, u
 	get_gamma(m, m, 1); // This is to get a matrix of random walks on the graph -> TODO: find out if something else is more suitable
 	while (iteration < max_iter && diff_norm > numeric_limits<float>::epsilon()) {
 		get_exp(m, &msquared, expansion);
+		prune_columns(&msquared);
 		get_gamma(&msquared, &m_update, inflation);
 		*m -= m_update;
 		diff_norm = m->norm();
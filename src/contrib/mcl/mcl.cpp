@@ -22,6 +22,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <numeric>
 #include <iomanip>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "mcl.h"
 #include "sparse_matrix_stream.h"
 #include "../util/util.h"
@@ -222,7 +224,7 @@ Eigen::SparseMatrix<float> MCL::get_sparse_matrix_and_clear(vector<int64_t>* ord
 		}
 	}
 	m_sparse.setFromTriplets(m->begin(), m->end());
-	m->clear();
+	vector<Eigen::Triplet<float>>().swap(*m);
 	return m_sparse;
 }
 Eigen::MatrixXf MCL::get_dense_matrix_and_clear(vector<int64_t>* order, vector<Eigen::Triplet<float>>* m, bool symmetric){
@@ -231,10 +233,56 @@ Eigen::MatrixXf MCL::get_dense_matrix_and_clear(vector<int64_t>* order, vector<E
 		m_dense(t.row(), t.col()) = t.value();
 		if(symmetric && t.col() != t.row()) m_dense(t.col(), t.row()) = t.value();
 	}
-	m->clear();
+	vector<Eigen::Triplet<float>>().swap(*m);
 	return m_dense;
 }
 
+// Limits the estimated memory of the components that are processed at the same time. A thread acquires the memory of a
+// whole chunk before its entries are streamed from the SparseMatrixStream and releases it component by component, so
+// it never waits while holding memory. A chunk that exceeds the limit on its own is only started when no other
+// component is in memory.
+struct MemoryGovernor {
+	MemoryGovernor(double limit) :
+		limit(limit),
+		used(0.0)
+	{}
+	void acquire(double n) {
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, [&]() { return used == 0.0 || used + n <= limit; });
+		used += n;
+	}
+	void release(double n) {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			used -= n;
+		}
+		cv.notify_all();
+	}
+private:
+	const double limit;
+	double used;
+	std::mutex mtx;
+	std::condition_variable cv;
+};
+
+// Rough memory estimate of the 3 matrices of a Markov process on a component with n nodes and nnz entries. For sparse
+// matrices, the expansion is assumed to square the average number of neighbors.
+static double mcl_memory(double n, double nnz, bool sparse) {
+	if (!sparse)
+		return 3.0 * sizeof(float) * n * n;
+	double nnz_exp = min(n * n, nnz * nnz / n);
+	if (config.cluster_mcl_prune_max > 0)
+		nnz_exp = min(nnz_exp, n * config.cluster_mcl_prune_max);
+	return 3.0 * (2 * sizeof(uint32_t) + sizeof(float)) * max(nnz_exp, nnz);
+}
+
+// Rough memory estimate of the entries of a component while they are collected from the stream: a set node per entry
+// when read from the graph file, the collected triplets and their mirror images for symmetric graphs.
+static double triplet_memory(double entries, bool in_memory, bool symmetric) {
+	const double node = in_memory ? 0.0 : 4.0 * sizeof(void*) + sizeof(Eigen::Triplet<float>);
+	return entries * (node + (symmetric ? 2.0 : 1.0) * sizeof(Eigen::Triplet<float>));
+}
+
 void MCL::run(){
 	// testing
 	// LazyDisjointIntegralSet<uint32_t> test(5);
@@ -368,6 +416,8 @@ void MCL::run(){
 	timer.go("Computing independent components");
 	vector<vector<int64_t>> indices = ms->get_indices();
 	ms->clear_disjoint_set();
+	const vector<uint64_t> entries = ms->count_entries(indices);
+	const bool in_memory = ms->is_in_memory();
 	uint64_t nElements = ms->getNumberOfElements();
 	uint32_t nComponents = count_if(indices.begin(), indices.end(), [](vector<int64_t> v){ return v.size() > 0;});
 	uint32_t nComponentsLt1 = count_if(indices.begin(), indices.end(), [](vector<int64_t> v){ return v.size() > 1;});
@@ -399,12 +449,18 @@ void MCL::run(){
 	int64_t max_job_size = 0;
 	for(uint32_t i=0; i<chunk_size; i++) max_job_size+=indices[sort_order[i]].size();
 	const bool symmetric = !config.cluster_mcl_nonsymmetric;
+	// Components whose dense matrices (3 are needed at a time) would exceed the per thread share of the memory limit
+	// are always computed sparsely.
+	const double mem_limit = (double)Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT));
+	const double dense_mem_limit = mem_limit / max(nThreads, 1);
+	MemoryGovernor governor(mem_limit);
 	
 	// Collect some stats on the way
 	uint32_t* jobs_per_thread = new uint32_t[nThreads];
 	float* time_per_thread = new float[nThreads];
 	atomic_uint n_clusters_found(0);
-	atomic_uint component_counter(nThreads*chunk_size);
+	// Components are handed out in chunks in order of decreasing size, so the largest ones start first.
+	atomic_uint component_counter(0);
 	atomic_uint n_dense_calculations(0);
 	atomic_uint n_sparse_calculations(0);
 	atomic_uint nClustersEq1(0);
@@ -417,15 +473,29 @@ void MCL::run(){
 		uint32_t n_singletons = 0;
 		uint32_t n_jobs_done = 0;
 		int64_t cluster_id = iThr;
-		uint32_t my_counter = iThr*chunk_size;
 		int64_t my_chunk_size = chunk_size;
+		uint32_t my_counter = component_counter.fetch_add(my_chunk_size, memory_order_relaxed);
 		while(my_counter < max_counter){
 			unordered_set<uint32_t> all;
 			uint32_t upper_limit =  min(my_counter+my_chunk_size, max_counter);
 			vector<vector<int64_t>*> loc_i;
+			vector<bool> loc_sparse;
+			vector<double> loc_mem;
+			double chunk_mem = 0.0;
 			for(uint32_t chunk_counter = my_counter; chunk_counter<upper_limit; chunk_counter++){
-				loc_i.push_back(&indices[sort_order[chunk_counter]]);
+				const int64_t iComponent = sort_order[chunk_counter];
+				const double n = (double)indices[iComponent].size();
+				const double nnz = symmetric ? 2.0 * entries[iComponent] : (double)entries[iComponent];
+				const float sparsity = 1.0 - entries[iComponent] / (n * n);
+				const bool dense_fits = mcl_memory(n, nnz, false) <= dense_mem_limit;
+				const bool sparse = (sparsity >= config.cluster_mcl_sparsity_switch || !dense_fits) && expansion - (int) expansion == 0;
+				const double mem = n > 1 ? triplet_memory(entries[iComponent], in_memory, symmetric) + mcl_memory(n, nnz, sparse) : 0.0;
+				loc_i.push_back(&indices[iComponent]);
+				loc_sparse.push_back(sparse);
+				loc_mem.push_back(mem);
+				chunk_mem += mem;
 			}
+			governor.acquire(chunk_mem);
 			vector<vector<Eigen::Triplet<float>>> loc_c = ms->collect_components(&loc_i, iThr);
 			uint32_t ichunk = 0;
 			for(uint32_t chunk_counter = my_counter; chunk_counter<upper_limit; chunk_counter++){
@@ -439,10 +509,8 @@ void MCL::run(){
 					vector<unordered_set<uint32_t>> list_of_sets;
 					unordered_set<uint32_t> attractors;
 
-					const float sparsity = 1.0-(1.0 * m->size()) / (order->size()*order->size());
 					high_resolution_clock::time_point t = high_resolution_clock::now();
-					//TODO: a size limit for the dense matrix should control this as well
-					if(sparsity >= config.cluster_mcl_sparsity_switch && expansion - (int) expansion == 0){ 
+					if(loc_sparse[ichunk]){ 
 						n_sparse++;
 						Eigen::SparseMatrix<float> m_sparse = get_sparse_matrix_and_clear(order, m, symmetric);
 						sparse_create_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
@@ -486,6 +554,7 @@ void MCL::run(){
 						list_of_sets = disjointSet.getListOfSets();
 						dense_list_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
 					}
+					governor.release(loc_mem[ichunk]);
 					for(unordered_set<uint32_t> subset : list_of_sets){
 						assert(cluster_id < 0x3fffffffffffffff);
 						for(uint32_t el : subset){
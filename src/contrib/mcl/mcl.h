@@ -44,7 +44,7 @@ class MCL: public ClusteringAlgorithm {
 private:
 	using Weight = float;
 	using Id = SparseMatrixStream<Weight>::Id;
-	vector<Eigen::Triplet<float>> sparse_matrix_multiply(Eigen::SparseMatrix<float>* a, Eigen::SparseMatrix<float>* b , uint32_t iThr, uint32_t nThr);
+	vector<Eigen::Triplet<float>> sparse_matrix_multiply(Eigen::SparseMatrix<float>* a, Eigen::SparseMatrix<float>* b, std::atomic<int64_t>& next_col);
 	vector<Eigen::Triplet<float>> sparse_matrix_get_gamma(Eigen::SparseMatrix<float>* in, float r, uint32_t iThr, uint32_t nThr);
 	float sparse_matrix_get_norm(Eigen::SparseMatrix<float>* in, uint32_t nThr);
 	void print_stats(int64_t nElements, int64_t nComponents, int64_t nComponentsLt1, vector<int64_t>& sort_order, vector<vector<int64_t>>& indices, SparseMatrixStream<float>* ms);
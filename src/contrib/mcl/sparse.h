@@ -23,28 +23,50 @@ using std::runtime_error;
 
 namespace Workflow { namespace Cluster{
 		
-vector<Eigen::Triplet<float>> MCL::sparse_matrix_multiply(Eigen::SparseMatrix<float>* a, Eigen::SparseMatrix<float>* b , uint32_t iThr, uint32_t nThr){
-	int64_t n_cols = b->cols();
-	int64_t n_rows = a->rows();
+// Computes the columns of a*b, which the threads claim in blocks of MULTIPLY_BLOCK columns. The product columns are
+// accumulated sparsely. If pruning is enabled, entries below the prune threshold are dropped and only the largest
+// prune_max entries per column are kept, as in the original MCL. The following inflation step renormalizes the columns.
+vector<Eigen::Triplet<float>> MCL::sparse_matrix_multiply(Eigen::SparseMatrix<float>* a, Eigen::SparseMatrix<float>* b, std::atomic<int64_t>& next_col){
+	const int64_t MULTIPLY_BLOCK = 64;
+	const int64_t n_cols = b->cols();
+	const int64_t n_rows = a->rows();
+	const float threshold = max((float)config.cluster_mcl_prune_threshold, numeric_limits<float>::epsilon());
+	const size_t prune_max = config.cluster_mcl_prune_max;
 	std::vector<float> result_col(n_rows, 0.0);
-	vector<Eigen::Triplet<float>> data;
-	for (uint32_t j=0; j<n_cols; ++j) {
-		if(j%nThr == iThr){
-			fill(result_col.begin(), result_col.end(), 0.0f);
+	std::vector<bool> touched(n_rows, false);
+	std::vector<int64_t> rows;
+	vector<Eigen::Triplet<float>> data, col;
+	for (;;) {
+		const int64_t begin = next_col.fetch_add(MULTIPLY_BLOCK, memory_order_relaxed);
+		if (begin >= n_cols)
+			break;
+		const int64_t end = min(begin + MULTIPLY_BLOCK, n_cols);
+		for (int64_t j = begin; j < end; ++j) {
 			for (Eigen::SparseMatrix<float>::InnerIterator  rhsIt(*b, j); rhsIt; ++rhsIt) {
 				const float y = rhsIt.value();
 				const int64_t k = rhsIt.row();
 				for (Eigen::SparseMatrix<float>::InnerIterator lhsIt(*a, k); lhsIt; ++lhsIt) {
 					const int64_t i = lhsIt.row();
-					const float x = lhsIt.value();
-					result_col[i] += x*y;
+					if (!touched[i]) {
+						touched[i] = true;
+						rows.push_back(i);
+					}
+					result_col[i] += lhsIt.value()*y;
 				}
 			}
-			for (int64_t i=0; i<n_rows; ++i) {
-				if(abs(result_col[i]) > numeric_limits<float>::epsilon()) {
-					data.emplace_back(i, j, result_col[i]);
-				}
+			for (const int64_t i : rows) {
+				if (abs(result_col[i]) > threshold)
+					col.emplace_back(i, j, result_col[i]);
+				result_col[i] = 0.0f;
+				touched[i] = false;
+			}
+			rows.clear();
+			if (prune_max > 0 && col.size() > prune_max) {
+				std::nth_element(col.begin(), col.begin() + prune_max, col.end(), [](const Eigen::Triplet<float>& x, const Eigen::Triplet<float>& y) { return abs(x.value()) > abs(y.value()); });
+				col.resize(prune_max);
 			}
+			data.insert(data.end(), col.begin(), col.end());
+			col.clear();
 		}
 	}
 	return data;
@@ -59,8 +81,9 @@ void MCL::get_exp(Eigen::SparseMatrix<float>* in, Eigen::SparseMatrix<float>* ou
 			// Note: this is a workaround for a crash in Eigen
 			vector<Eigen::Triplet<float>> data;
 			std::mutex m;
+			std::atomic<int64_t> next_col(0);
 			auto mult = [&](const uint32_t iThr){
-				vector<Eigen::Triplet<float>> t_data = sparse_matrix_multiply(in, out, iThr, nThr);
+				vector<Eigen::Triplet<float>> t_data = sparse_matrix_multiply(in, out, next_col);
 				m.lock();
 				data.insert(data.end(), t_data.begin(), t_data.end());
 				m.unlock();
@@ -385,6 +385,40 @@ public:
 		}
 	}
 
+	// Returns the number of stored entries of each component, without loading the entries from the graph file.
+	vector<uint64_t> count_entries(const vector<vector<Id>>& indices){
+		vector<int64_t> component(n, -1);
+		for(size_t iset = 0; iset < indices.size(); iset++){
+			for(Id index : indices[iset]){
+				component[index] = iset;
+			}
+		}
+		vector<uint64_t> counts(indices.size(), 0);
+		if(in_memory){
+			for(const Eigen::Triplet<T>& t : *data){
+				counts[component[t.row()]]++;
+			}
+			return counts;
+		}
+		ifstream in(file_name, ios::in | ios::binary);
+		if(!in){
+			throw runtime_error("Cannot read the graph file");
+		}
+		in.seekg(sizeof(size_t) + sizeof(uint32_t), ios::beg);
+		while(true){
+			Id first_component;
+			in.read((char*) &first_component, sizeof(Id));
+			uint32_t size;
+			in.read((char*) &size, sizeof(uint32_t));
+			if(!in){
+				break;
+			}
+			counts[component[first_component]] += size;
+			in.seekg((unsigned long long)size*unit_size, ios::cur);
+		}
+		return counts;
+	}
+
 	vector<vector<Id>> get_indices(){
 		vector<unordered_set<Id>> sets = disjointSet->getListOfSets();
 		vector<vector<Id>> indices;
@@ -393,6 +427,9 @@ public:
 		}
 		return indices;
 	}
+	bool is_in_memory() const {
+		return in_memory;
+	}
 	uint64_t getNumberOfElements(){
 		return data->size();
 	}
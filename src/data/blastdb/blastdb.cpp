@@ -469,7 +469,7 @@ void BlastDB::prep_blast_db(const string& path) {
 		CSeqDB volume(db, CSeqDB::eProtein);
 		const int n = volume.GetNumOIDs();
 		message_stream << "Number of sequences: " << n << endl;
-		OutputFile out(db + ".acc", Compressor::ZSTD);
+		OutputFile out(db + ".acc", Compressor::ZSTD, "wb", config.threads_);
 		TextBuffer buf;
 		buf << BlastDB::ACCESSION_FIELD << '\n';
 		size_t id_count = 0;
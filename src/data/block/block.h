@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include <list>
+#include <memory>
 #include <vector>
 #include <mutex>
 #include "../sequence_set.h"
@@ -28,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../masking/masking.h"
 
 struct SequenceFile;
+struct SharedSegment;
 
 struct SeqInfo {
 	BlockId block_id;
@@ -118,6 +120,8 @@ private:
 	std::mutex mask_lock_;
 	MaskingTable soft_masking_table_;
 	bool soft_masked_;
+	// Shared memory segment that holds the sequences and ids if they are views (see SequenceFile::load_seqs_shared).
+	std::shared_ptr<SharedSegment> segment_;
 
 	friend struct SequenceFile;
 
@@ -0,0 +1,138 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2022 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <memory>
+#include <string.h>
+#include "block.h"
+#include "../sequence_file.h"
+#include "../dmnd/dmnd.h"
+#include "../../util/system/shared_segment.h"
+#include "../../util/log_stream.h"
+#include "../../util/util.h"
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::endl;
+
+namespace {
+
+struct SegmentHeader {
+	int64_t next_oid, seqs, seq_raw_len, ids, id_raw_len;
+};
+
+template<typename T>
+size_t serialized_size(const T& s) {
+	return s.size() * sizeof(Loc) + (s.raw_len() + T::PERIMETER_PADDING) * sizeof(*s.data());
+}
+
+template<typename T>
+char* serialize(const T& s, char* dst) {
+	for (BlockId i = 0; i < s.size(); ++i) {
+		const Loc l = s.length(i);
+		memcpy(dst, &l, sizeof(Loc));
+		dst += sizeof(Loc);
+	}
+	const size_t n = (s.raw_len() + T::PERIMETER_PADDING) * sizeof(*s.data());
+	memcpy(dst, s.data(), n);
+	return dst + n;
+}
+
+// Makes s a view of the serialized set at src and returns the end of its data.
+template<typename T>
+char* view(T& s, BlockId count, char* src) {
+	vector<Loc> lengths(count);
+	memcpy(lengths.data(), src, count * sizeof(Loc));
+	src += count * sizeof(Loc);
+	s.assign_external((decltype(s.data()))src, lengths.cbegin(), lengths.cend());
+	return src + (s.raw_len() + T::PERIMETER_PADDING) * sizeof(*s.data());
+}
+
+}
+
+static string segment_name(const DatabaseFile& db, OId begin, size_t size, SequenceFile::LoadFlags flags) {
+	return "/diamond_" + hex_print(db.header2.hash, 8) + '_' + std::to_string(begin) + '_' + std::to_string(size) + '_' + std::to_string((int)flags);
+}
+
+Block* SequenceFile::load_seqs_shared(const size_t max_letters, const BitVector* filter, LoadFlags flags, const Chunk& chunk) {
+	if (type_ != Type::DMND || (filter && !filter->empty()))
+		return load_seqs(max_letters, filter, flags, chunk);
+
+	const DatabaseFile& db = dynamic_cast<const DatabaseFile&>(*this);
+	const OId begin = max_letters == 0 ? (OId)chunk.offset : tell_seq();
+	const string name = segment_name(db, begin, max_letters == 0 ? chunk.n_seqs : max_letters, flags & ~LoadFlags::LAZY_MASKING);
+
+	// The sequences and ids of the block are backed by the segment, which stays attached until the block is freed.
+	auto back_by = [](Block* block, SharedSegment* segment) {
+		const SegmentHeader& h = *(const SegmentHeader*)segment->data();
+		char* ptr = segment->data() + sizeof(SegmentHeader);
+		ptr = view(block->seqs_, (BlockId)h.seqs, ptr);
+		if (h.ids)
+			ptr = view(block->ids_, (BlockId)h.ids, ptr);
+		else
+			block->ids_.clear();
+		block->block2oid_.resize(h.seqs);
+		memcpy(block->block2oid_.data(), ptr, h.seqs * sizeof(OId));
+		block->segment_.reset(segment);
+	};
+
+	SharedSegment* attached = SharedSegment::attach(name);
+	if (attached) {
+		Block* block = new Block(alphabet_);
+		back_by(block, attached);
+		if (flag_any(flags, LoadFlags::LAZY_MASKING))
+			block->masked_.resize(block->seqs_.size(), false);
+		set_seqinfo_ptr(((const SegmentHeader*)attached->data())->next_oid);
+		log_stream << "Attached shared memory segment " << name << endl;
+		return block;
+	}
+
+	Block* block = load_seqs(max_letters, filter, flags, chunk);
+	if (block->empty())
+		return block;
+	const bool ids = !block->ids_.empty();
+	const size_t size = sizeof(SegmentHeader)
+		+ serialized_size(block->seqs_)
+		+ (ids ? serialized_size(block->ids_) : 0)
+		+ block->block2oid_.size() * sizeof(OId);
+	unique_ptr<SharedSegment> segment(SharedSegment::create(name, size));
+	if (!segment)
+		return block;
+	SegmentHeader& h = *(SegmentHeader*)segment->data();
+	h.next_oid = tell_seq();
+	h.seqs = block->seqs_.size();
+	h.seq_raw_len = block->seqs_.raw_len();
+	h.ids = ids ? block->ids_.size() : 0;
+	h.id_raw_len = ids ? block->ids_.raw_len() : 0;
+	char* ptr = segment->data() + sizeof(SegmentHeader);
+	ptr = serialize(block->seqs_, ptr);
+	if (ids)
+		ptr = serialize(block->ids_, ptr);
+	memcpy(ptr, block->block2oid_.data(), block->block2oid_.size() * sizeof(OId));
+	segment->publish();
+	log_stream << "Published shared memory segment " << name << endl;
+	// Replace the loaded copy by a private view, so that the pages not modified by this process stay shared.
+	attached = SharedSegment::attach(name);
+	if (attached)
+		back_by(block, attached);
+	else
+		block->segment_.reset(segment.release());
+	return block;
+}
\ No newline at end of file
@@ -22,6 +22,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <limits>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <deque>
+#include <algorithm>
+#include <string.h>
 #include "../basic/config.h"
 #include "../util/seq_file_format.h"
 #include "../util/log_stream.h"
@@ -29,9 +34,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../taxonomy.h"
 #include "../taxon_list.h"
 #include "../taxonomy_nodes.h"
+#include "../taxon_filter_index.h"
 #include "../util/algo/MurmurHash3.h"
 #include "../util/io/record_reader.h"
 #include "../util/parallel/multiprocessing.h"
+#include "../util/parallel/thread_pool.h"
 #include "dmnd.h"
 #include "../reference.h"
 #include "../taxonomy.h"
@@ -40,6 +47,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../util/util.h"
 #include "../fasta/fasta_file.h"
 #include "../../util/sequence/sequence.h"
+#include "../../util/io/input_stream_buffer.h"
+#include "../../lib/mio/mmap.hpp"
 
 using std::tuple;
 using std::string;
@@ -138,9 +147,12 @@ void DatabaseFile::init(Flags flags)
 DatabaseFile::DatabaseFile(const string &input_file, Metadata metadata, Flags flags, const ValueTraits& value_traits):
 	SequenceFile(SequenceFile::Type::DMND, Alphabet::STD, flags, FormatFlags::DICT_LENGTHS | FormatFlags::DICT_SEQIDS | FormatFlags::SEEKABLE | FormatFlags::LENGTH_LOOKUP, value_traits),
 	InputFile(auto_append_extension_if_exists(input_file, FILE_EXTENSION), InputFile::BUFFERED),
-	temporary(false)
+	temporary(false),
+	mmap_pos_(0)
 {
 	init(flags);
+	if (config.mmap_db)
+		map_file();
 
 	vector<string> e;
 	if (flag_any(metadata, Metadata::TAXON_MAPPING) && !has_taxon_id_lists())
@@ -173,7 +185,8 @@ DatabaseFile::DatabaseFile(const string &input_file, Metadata metadata, Flags fl
 DatabaseFile::DatabaseFile(TempFile &tmp_file, const ValueTraits& value_traits):
 	SequenceFile(SequenceFile::Type::DMND, Alphabet::STD, Flags::NONE, FormatFlags::DICT_LENGTHS | FormatFlags::DICT_SEQIDS | FormatFlags::SEEKABLE | FormatFlags::LENGTH_LOOKUP, value_traits),
 	InputFile(tmp_file, 0),
-	temporary(true)
+	temporary(true),
+	mmap_pos_(0)
 {
 	init();
 }
@@ -182,7 +195,26 @@ int64_t DatabaseFile::file_count() const {
 	return 1;
 }
 
+void DatabaseFile::map_file() {
+	if (InputFile::file_name == "-" || InputFile::file_name.empty())
+		throw std::runtime_error("Memory mapping requires the database to be a regular file.");
+	try {
+		mmap_.reset(new mio::mmap_source(InputFile::file_name));
+	}
+	catch (std::system_error& e) {
+		throw std::runtime_error("Error memory mapping database file " + InputFile::file_name + ": " + e.what());
+	}
+	advise_mapping(mmap_->data(), mmap_->mapped_length(), MmapAccess::SEQUENTIAL);
+}
+
+const char* DatabaseFile::mapped_data(size_t n) const {
+	if (mmap_pos_ + n > mmap_->size())
+		throw std::runtime_error("Unexpected end of file.");
+	return mmap_->data() + mmap_pos_;
+}
+
 void DatabaseFile::close() {
+	mmap_.reset();
 	if (temporary)
 		InputFile::close_and_delete();
 	else
@@ -222,6 +254,148 @@ static void push_seq(const Sequence &seq, const char *id, size_t id_len, uint64_
 	offset += seq.length() + id_len + 3;
 }
 
+// Input of makedb is read in chunks of complete records. The chunks are parsed, converted and masked by the tasks
+// of a thread pool and written in input order, so the OIDs and the database hash do not depend on the number
+// of threads.
+struct MakedbChunk {
+	std::string text;
+	size_t first_line;
+	vector<Letter> letters;
+	vector<Loc> lengths;
+	vector<size_t> id_begin;
+	vector<bool> dna;
+	string ids;
+	vector<pair<string, size_t>> accessions;
+};
+
+static const size_t MAKEDB_CHUNK_SIZE = 4 * MEGABYTES;
+
+// Returns the end of the last complete record in [begin, end).
+static size_t record_boundary(const char* begin, const char* end, bool fastq) {
+	if (!fastq) {
+		for (const char* p = end - 1; p > begin; --p)
+			if (*p == '>' && p[-1] == '\n')
+				return p - begin;
+		return 0;
+	}
+	const char* p = begin, *boundary = begin;
+	int n = 0;
+	while (const char* nl = (const char*)memchr(p, '\n', end - p)) {
+		if (n > 0 || nl > p)
+			++n;
+		p = nl + 1;
+		if (n == 4) {
+			boundary = p;
+			n = 0;
+		}
+	}
+	return boundary - begin;
+}
+
+// Appends up to n bytes of input to buf.
+static void fill(InputFile& in, string& buf, bool& eof, size_t n) {
+	const size_t size = buf.size();
+	buf.resize(size + n);
+	buf.resize(size + in.read_raw(&buf[size], n));
+	eof = buf.size() < size + n;
+}
+
+// Reads the next chunk of complete records into chunk.text. Returns false at the end of the input.
+static bool read_chunk(InputFile& in, string& buf, bool& eof, MakedbChunk& chunk, bool fastq, size_t& line_count) {
+	if (!eof && buf.size() < MAKEDB_CHUNK_SIZE)
+		fill(in, buf, eof, MAKEDB_CHUNK_SIZE - buf.size());
+	size_t boundary;
+	while ((boundary = eof ? buf.size() : record_boundary(buf.data(), buf.data() + buf.size(), fastq)) == 0 && !eof)
+		fill(in, buf, eof, std::max(buf.size(), MAKEDB_CHUNK_SIZE));
+	if (boundary == 0)
+		return false;
+	chunk.text.assign(buf, 0, boundary);
+	buf.erase(0, boundary);
+	chunk.first_line = line_count;
+	line_count += std::count(chunk.text.begin(), chunk.text.end(), '\n');
+	return true;
+}
+
+static void parse_chunk(MakedbChunk& chunk, bool fastq, bool check_dna, bool mask, bool accessions) {
+	const char* p = chunk.text.data(), * const end = p + chunk.text.size(), * b, * e;
+	size_t line = chunk.first_line;
+	auto getline = [&]() {
+		if (p >= end)
+			return false;
+		const char* nl = (const char*)memchr(p, '\n', end - p);
+		b = p;
+		e = nl ? nl : end;
+		p = nl ? nl + 1 : end;
+		if (e > b && e[-1] == '\r')
+			--e;
+		++line;
+		return true;
+	};
+	auto convert = [&]() {
+		try {
+			for (const char* i = b; i < e; ++i)
+				chunk.letters.push_back(value_traits.from_char(*i));
+		}
+		catch (invalid_sequence_char_exception& ex) {
+			throw StreamReadException(line, ex.what());
+		}
+	};
+	size_t seq_begin = 0;
+	bool open = false;
+	auto finish = [&]() {
+		const Loc len = Loc(chunk.letters.size() - seq_begin);
+		if (len == 0) {
+			chunk.ids.resize(chunk.id_begin.back());
+			chunk.id_begin.pop_back();
+			return;
+		}
+		// Only the first sequences of the input are checked, which are at the start of a chunk.
+		if (check_dna && (int64_t)chunk.lengths.size() < SequenceFile::CHECK_FOR_DNA_COUNT)
+			chunk.dna.push_back(Util::Seq::looks_like_dna(Sequence(chunk.letters.data() + seq_begin, len)));
+		if (mask)
+			Masking::get().mask_bit(chunk.letters.data() + seq_begin, len);
+		if (accessions)
+			for (const string& s : accession_from_title(chunk.ids.c_str() + chunk.id_begin.back()))
+				chunk.accessions.emplace_back(s, chunk.lengths.size());
+		chunk.lengths.push_back(len);
+	};
+	auto start = [&]() {
+		seq_begin = chunk.letters.size();
+		chunk.id_begin.push_back(chunk.ids.size());
+		chunk.ids.append(b + 1, e);
+		chunk.ids.push_back('\0');
+	};
+	while (getline()) {
+		if (b == e)
+			continue;
+		if (fastq) {
+			if (*b != '@')
+				throw StreamReadException(line, "FASTQ format error: Missing '@' at record start.");
+			start();
+			if (getline())
+				convert();
+			if (!getline() || b == e || *b != '+')
+				throw StreamReadException(line, "FASTQ format error: Missing '+' line in record.");
+			getline();
+			finish();
+		}
+		else if (*b == '>') {
+			if (open)
+				finish();
+			start();
+			open = true;
+		}
+		else if (!open)
+			throw StreamReadException(line, "FASTA format error: Missing '>' at record start.");
+		else
+			convert();
+	}
+	if (open)
+		finish();
+	chunk.id_begin.push_back(chunk.ids.size());
+	std::string().swap(chunk.text);
+}
+
 void DatabaseFile::make_db()
 {
 	config.file_buffer_size = 4 * MEGABYTES;
@@ -237,7 +411,7 @@ void DatabaseFile::make_db()
 	task_timer timer("Opening the database file", true);
 
 	value_traits = (config.dbtype == SequenceType::amino_acid) ? amino_acid_traits : nucleotide_traits;
-    FastaFile db_file({ input_file_name }, Metadata (), Flags::NONE, value_traits);
+	InputFile db_file(input_file_name, InputStreamBuffer::ASYNC);
 
     unique_ptr<OutputFile> out(new OutputFile(config.database));
 	ReferenceHeader header;
@@ -246,65 +420,83 @@ void DatabaseFile::make_db()
     *out << header;
 	*out << header2;
 
-	size_t letters = 0, n = 0, n_seqs = 0, total_seqs = 0;
+	size_t letters = 0, n_seqs = 0, line_count = 0;
 	uint64_t offset = out->tell();
 
-    LoadFlags flags = SequenceFile::LoadFlags::ALL;
-    if (config.dbtype == SequenceType::nucleotide){
+    if (config.dbtype == SequenceType::nucleotide)
         header.db_version = ReferenceHeader::current_db_version_nucl;
-        flags |= SequenceFile::LoadFlags::DNA_PRESERVATION;
-    }
 
-    Block* block;
-	const FASTA_format format;
 	vector<SeqInfo> pos_array;
 	ExternalSorter<pair<string, OId>> accessions;
-	try {
-		while (true) {
-			timer.go("Loading sequences");
-			block = db_file.load_seqs((int64_t)1e9, nullptr, flags);
-			if (block->empty()) {
-				delete block;
-				break;
-			}
-			n = block->seqs().size();
-
-			if (config.dbtype == SequenceType::amino_acid && config.masking_ != "0") {
-				timer.go("Masking sequences");
-				mask_seqs(block->seqs(), Masking::get(), false, MaskingAlgo::SEG);
-			}
+	const bool check_dna = config.dbtype == SequenceType::amino_acid && !config.ignore_warnings,
+		mask = config.dbtype == SequenceType::amino_acid && config.masking_ != "0",
+		parse_accessions = !config.prot_accession2taxid.empty();
+	const size_t max_pending = (size_t)std::max(config.threads_, 1);
+	std::deque<std::future<MakedbChunk>> jobs;
+	ThreadPool pool;
+	ThreadPool::TaskSet task_set(pool, 0);
+	pool.run(max_pending);
+	string buf;
+	bool eof = false;
+
+	auto write_chunk = [&](const MakedbChunk& chunk) {
+		const Letter* seq = chunk.letters.data();
+		for (size_t i = 0; i < chunk.lengths.size(); ++i) {
+			const Sequence s(seq, chunk.lengths[i]);
+			const char* id = chunk.ids.data() + chunk.id_begin[i];
+			const size_t id_len = chunk.id_begin[i + 1] - chunk.id_begin[i] - 1;
+			if ((int64_t)n_seqs < CHECK_FOR_DNA_COUNT && i < chunk.dna.size() && chunk.dna[i])
+				throw std::runtime_error("The sequences are expected to be proteins but only contain DNA letters. Use the option --ignore-warnings to proceed.");
+			push_seq(s, id, id_len, offset, pos_array, *out, letters, n_seqs);
+			MurmurHash3_x64_128(s.data(), (int)s.length(), header2.hash, header2.hash);
+			MurmurHash3_x64_128(id, id_len, header2.hash, header2.hash);
+			seq += chunk.lengths[i];
+		}
+		for (const auto& a : chunk.accessions)
+			accessions.push(std::make_pair(a.first, OId(n_seqs - chunk.lengths.size() + a.second)));
+	};
 
-            timer.go("Writing sequences");
-			for (size_t i = 0; i < n; ++i) {
-				Sequence seq = block->seqs()[i];
-				if (seq.length() == 0)
-					throw std::runtime_error("File format error: sequence of length 0 at line " + std::to_string(db_file.line_count()));
-				push_seq(seq, block->ids()[i], block->ids().length(i), offset, pos_array, *out, letters, n_seqs);
+	timer.go("Loading sequences");
+	try {
+		fill(db_file, buf, eof, MAKEDB_CHUNK_SIZE);
+		if (buf.empty() || buf[0] == '\n' || buf[0] == '\r')
+			throw std::runtime_error("Error detecting input file format. First line seems to be blank.");
+		if (buf[0] != '>' && buf[0] != '@')
+			throw std::runtime_error("Error detecting input file format. First line must begin with '>' (FASTA) or '@' (FASTQ).");
+		const bool fastq = buf[0] == '@';
+		MakedbChunk chunk;
+		while (read_chunk(db_file, buf, eof, chunk, fastq, line_count)) {
+			if (jobs.size() >= max_pending) {
+				write_chunk(jobs.front().get());
+				jobs.pop_front();
 			}
-			if (!config.prot_accession2taxid.empty()) {
-				timer.go("Writing accessions");
-				for (size_t i = 0; i < n; ++i) {
-					vector<string> acc = accession_from_title(block->ids()[i]);
-					for (const string& s : acc)
-						accessions.push(std::make_pair(s, total_seqs + i));
+			auto result = std::make_shared<std::promise<MakedbChunk>>();
+			auto input = std::make_shared<MakedbChunk>(std::move(chunk));
+			jobs.push_back(result->get_future());
+			task_set.enqueue([result, input, fastq, check_dna, mask, parse_accessions]() {
+				try {
+					parse_chunk(*input, fastq, check_dna, mask, parse_accessions);
+					result->set_value(std::move(*input));
 				}
-			}
-			timer.go("Hashing sequences");
-			for (size_t i = 0; i < n; ++i) {
-				Sequence seq = block->seqs()[i];
-				MurmurHash3_x64_128(seq.data(), (int)seq.length(), header2.hash, header2.hash);
-				MurmurHash3_x64_128(block->ids()[i], block->ids().length(i), header2.hash, header2.hash);
-			}
-			delete block;
-			total_seqs += n;
+				catch (...) {
+					result->set_exception(std::current_exception());
+				}
+			});
+			chunk = MakedbChunk();
 		}
+		while (!jobs.empty()) {
+			write_chunk(jobs.front().get());
+			jobs.pop_front();
+		}
+		task_set.wait();
 	}
 	catch (std::exception&) {
+		task_set.wait();
+		jobs.clear();
 		out->close();
 		out->remove();
 		throw;
 	}
-
 	timer.finish();
 
 	timer.go("Writing trailer");
@@ -515,22 +707,45 @@ size_t DatabaseFile::id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_nex
 }
 
 void DatabaseFile::seek_offset(size_t p) {
+	// read_seq() reads from the stream also if the file is mapped, so the stream is positioned as well.
+	if (mmap_)
+		mmap_pos_ = p;
 	seek(p);
 }
 
 void DatabaseFile::read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) {
-	if (seek)
-		this->seek(pos);
-	read(dst - 1, len + 2);
+	if (mmap_) {
+		if (seek)
+			mmap_pos_ = pos;
+		memcpy(dst - 1, mapped_data(len + 2), len + 2);
+		mmap_pos_ += len + 2;
+	}
+	else {
+		if (seek)
+			this->seek(pos);
+		read(dst - 1, len + 2);
+	}
 	*(dst - 1) = Sequence::DELIMITER;
 	*(dst + len) = Sequence::DELIMITER;
 }
 
 void DatabaseFile::read_id_data(const int64_t oid, char* dst, size_t len) {
-	read(dst, len + 1);
+	if (mmap_) {
+		memcpy(dst, mapped_data(len + 1), len + 1);
+		mmap_pos_ += len + 1;
+	}
+	else
+		read(dst, len + 1);
 }
 
 void DatabaseFile::skip_id_data() {
+	if (mmap_) {
+		const char* p = mapped_data(0);
+		const char* end = (const char*)memchr(p, '\0', mmap_->size() - mmap_pos_);
+		if (!end) throw std::runtime_error("Unexpected end of file.");
+		mmap_pos_ += end - p + 1;
+		return;
+	}
 	if (!seek_forward('\0')) throw std::runtime_error("Unexpected end of file.");
 }
 
@@ -584,6 +799,31 @@ BitVector* DatabaseFile::filter_by_accession(const std::string& file_name)
 	return nullptr;
 }
 
+bool DatabaseFile::filter_by_taxon_index(BitVector& v, const std::set<TaxId>& filter) const
+{
+	if (temporary || !taxon_list_ || !taxon_nodes_)
+		return false;
+	const string index_file = InputFile::file_name + TaxonFilterIndex::FILE_EXTENSION;
+	TaxonFilterIndex::Key key;
+	memcpy(key.db_hash, header2.hash, sizeof(key.db_hash));
+	key.db_size = file_size(InputFile::file_name.c_str());
+	key.seqs = sequence_count();
+	key.taxon_nodes = taxon_nodes_->size();
+	if (exists(index_file)) {
+		TaxonFilterIndex index(index_file);
+		if (index.key() == key) {
+			index.set_contained(v, filter, *taxon_nodes_);
+			return true;
+		}
+		message_stream << "Taxonomy filter index does not match the database: " << index_file << endl;
+	}
+	if (!config.taxon_index)
+		return false;
+	TaxonFilterIndex::build(index_file, key, *this, *taxon_nodes_);
+	TaxonFilterIndex(index_file).set_contained(v, filter, *taxon_nodes_);
+	return true;
+}
+
 const BitVector* DatabaseFile::builtin_filter()
 {
 	return nullptr;
@@ -616,12 +856,16 @@ size_t DatabaseFile::seq_length(size_t oid) const
 
 void DatabaseFile::init_random_access(const size_t query_block, const size_t ref_blocks, bool dictionary)
 {
+	if (mmap_)
+		advise_mapping(mmap_->data(), mmap_->mapped_length(), MmapAccess::RANDOM);
 	if(dictionary)
 		load_dictionary(query_block, ref_blocks);
 }
 
 void DatabaseFile::end_random_access(bool dictionary)
 {
+	if (mmap_)
+		advise_mapping(mmap_->data(), mmap_->mapped_length(), MmapAccess::SEQUENTIAL);
 	if (!dictionary)
 		return;
 	free_dictionary();
@@ -25,10 +25,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include <limits.h>
 #include <list>
+#include <memory>
 #include "../util/io/serializer.h"
 #include "../util/io/input_file.h"
 #include "../sequence_file.h"
 #include "../taxon_list.h"
+#include "../../lib/mio/forward.h"
 
 struct ReferenceHeader
 {
@@ -147,6 +149,7 @@ struct DatabaseFile : public SequenceFile, public InputFile
 	virtual void close_weakly() override;
 	virtual void reopen() override;
 	virtual BitVector* filter_by_accession(const std::string& file_name) override;
+	virtual bool filter_by_taxon_index(BitVector& v, const std::set<TaxId>& filter) const override;
 	virtual const BitVector* builtin_filter() override;
 	virtual std::string file_name() override;
 	virtual int64_t sparse_sequence_count() const override;
@@ -164,8 +167,12 @@ private:
 
 	void init(Flags flags = Flags::NONE);
 	void read_seqid_list();
+	void map_file();
+	const char* mapped_data(size_t n) const;
 
 	std::unique_ptr<TaxonList> taxon_list_;
 	std::vector<std::string> taxon_scientific_names_;
+	std::unique_ptr<mio::mmap_source> mmap_;
+	size_t mmap_pos_;
 
 };
@@ -226,4 +226,10 @@ SeedArray::SeedArray(Block& seqs, const SeedPartitionRange& range, const _filter
 	}
 }
 
-template SeedArray::SeedArray(Block&, const SeedPartitionRange&, const HashedSeedSet*, EnumCfg&);
\ No newline at end of file
+template SeedArray::SeedArray(Block&, const SeedPartitionRange&, const HashedSeedSet*, EnumCfg&);
+
+SeedArray::SeedArray(SeedEncoding code, array<vector<Entry>, Const::seedp>&& entries) :
+	key_bits(seed_bits(code)),
+	data_(nullptr),
+	entries_(std::move(entries))
+{}
\ No newline at end of file
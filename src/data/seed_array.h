@@ -69,6 +69,8 @@ struct SeedArray
 	template<typename _filter>
 	SeedArray(Block& seqs, const SeedPartitionRange& range, const _filter* filter, EnumCfg& cfg);
 
+	SeedArray(SeedEncoding code, std::array<std::vector<Entry>, Const::seedp>&& entries);
+
 	Entry* begin(unsigned i)
 	{
 		if (data_)
@@ -57,7 +57,6 @@ using std::get;
 using std::unique_ptr;
 using namespace Util::Tsv;
 
-static constexpr int64_t CHECK_FOR_DNA_COUNT = 10;
 const char* const SequenceFile::SEQID_HDR = "seqid";
 const DictId SequenceFile::DICT_EMPTY = std::numeric_limits<DictId>::max();
 
@@ -243,7 +242,7 @@ std::pair<Block*, int64_t> SequenceFile::load_onepass(const int64_t max_letters,
 
 size_t SequenceFile::dict_block(const size_t ref_block)
 {
-	return config.multiprocessing ? ref_block : 0;
+	return config.persistent_ref_blocks() ? ref_block : 0;
 }
 
 Block* SequenceFile::load_seqs(const size_t max_letters, const BitVector* filter, LoadFlags flags, const Chunk& chunk)
@@ -405,10 +404,10 @@ void SequenceFile::load_dict_block(InputFile* f, const size_t ref_block)
 
 void SequenceFile::load_dictionary(const size_t query_block, const size_t ref_blocks)
 {
-	if (!dict_file_ && !config.multiprocessing)
+	if (!dict_file_ && !config.persistent_ref_blocks())
 		return;
 	task_timer timer("Loading dictionary", 3);
-	if (config.multiprocessing) {
+	if (config.persistent_ref_blocks()) {
 		dict_oid_ = vector<vector<OId>>(ref_blocks);
 		if (flag_any(flags_, Flags::SELF_ALN_SCORES))
 			dict_self_aln_score_ = vector<vector<double>>(ref_blocks);
@@ -501,7 +500,7 @@ void SequenceFile::init_dict(const size_t query_block, const size_t target_block
 {
 	if (dict_file_)
 		dict_file_->close();
-	dict_file_.reset(config.multiprocessing ? new OutputFile(dict_file_name(query_block, target_block)) : new TempFile());
+	dict_file_.reset(config.persistent_ref_blocks() ? new OutputFile(dict_file_name(query_block, target_block)) : new TempFile());
 	next_dict_id_ = 0;
 	dict_alloc_size_ = 0;
 	block_to_dict_id_.clear();
@@ -517,7 +516,7 @@ void SequenceFile::init_dict_block(size_t block, size_t seq_count, bool persist)
 
 void SequenceFile::close_dict_block(bool persist)
 {
-	if (config.multiprocessing) {
+	if (config.persistent_ref_blocks()) {
 		dict_file_->close();
 		dict_file_.reset();
 	}
@@ -625,7 +624,7 @@ bool SequenceFile::load_dict_entry(InputFile& f, size_t ref_block)
 
 void SequenceFile::reserve_dict(const size_t ref_blocks)
 {
-	if (config.multiprocessing) {
+	if (config.persistent_ref_blocks()) {
 		if (flag_any(format_flags_, FormatFlags::DICT_LENGTHS))
 			dict_len_ = std::vector<std::vector<uint32_t>>(ref_blocks);
 		if (flag_any(format_flags_, FormatFlags::DICT_SEQIDS))
@@ -685,12 +684,21 @@ BitVector* SequenceFile::filter_by_taxonomy(const std::string& include, const st
 		throw std::runtime_error("Option --taxonlist/--taxon-exclude used with empty list.");
 	if (taxon_filter_list.find(1) != taxon_filter_list.end() || taxon_filter_list.find(0) != taxon_filter_list.end())
 		throw std::runtime_error("Option --taxonlist/--taxon-exclude used with invalid argument (0 or 1).");
+	if (filter_by_taxon_index(*v, taxon_filter_list)) {
+		if (e)
+			v->flip();
+		return v;
+	}
 	for (OId i = 0; i < sequence_count(); ++i)
 		if (taxon_nodes_->contained(taxids(i), taxon_filter_list) ^ e)
 			v->set(i);
 	return v;
 }
 
+bool SequenceFile::filter_by_taxon_index(BitVector& v, const std::set<TaxId>& filter) const {
+	return false;
+}
+
 void SequenceFile::build_acc_to_oid() {
 	acc2oid_.reserve(sequence_count());
 	set_seqinfo_ptr(0);
@@ -152,12 +152,14 @@ struct SequenceFile {
 	virtual void init_random_access(const size_t query_block, const size_t ref_blocks, bool dictionary = true) = 0;
 	virtual void end_random_access(bool dictionary = true) = 0;
 	virtual std::vector<OId> accession_to_oid(const std::string& acc) const;
+	virtual bool filter_by_taxon_index(BitVector& v, const std::set<TaxId>& filter) const;
 	virtual void init_write();
 	virtual void write_seq(const Sequence& seq, const std::string& id);
 	virtual ~SequenceFile();
 
 	Type type() const { return type_; }
 	Block* load_seqs(const size_t max_letters, const BitVector* filter = nullptr, LoadFlags flags = LoadFlags(3), const Chunk& chunk = Chunk());
+	Block* load_seqs_shared(const size_t max_letters, const BitVector* filter = nullptr, LoadFlags flags = LoadFlags(3), const Chunk& chunk = Chunk());
 	void get_seq();
 	Util::Tsv::File* make_seqid_list();
 	size_t total_blocks() const;
@@ -212,6 +214,9 @@ struct SequenceFile {
 		return n;
 	}
 
+	// Number of protein input sequences that are checked for looking like DNA.
+	static constexpr int64_t CHECK_FOR_DNA_COUNT = 10;
+
 protected:
 
 	static const char* const SEQID_HDR;
@@ -39,15 +39,64 @@ struct StringSetBase
 	static const char DELIMITER = _pchar;
 
 	StringSetBase():
-		data_ (PERIMETER_PADDING, _pchar)
+		data_ (PERIMETER_PADDING, _pchar),
+		base_ (data_.data()),
+		external_ (false)
 	{
 		limits_.push_back(PERIMETER_PADDING);
 	}
 
+	// Copies of a set that views external memory own their data.
+	StringSetBase(const StringSetBase& s):
+		data_ (s.base_, s.base_ + s.data_size()),
+		limits_ (s.limits_),
+		base_ (data_.data()),
+		external_ (false)
+	{}
+
+	StringSetBase(StringSetBase&& s) noexcept:
+		data_ (std::move(s.data_)),
+		limits_ (std::move(s.limits_)),
+		base_ (s.external_ ? s.base_ : data_.data()),
+		external_ (s.external_)
+	{}
+
+	StringSetBase& operator=(const StringSetBase& s) {
+		if (this != &s) {
+			data_.assign(s.base_, s.base_ + s.data_size());
+			limits_ = s.limits_;
+			base_ = data_.data();
+			external_ = false;
+		}
+		return *this;
+	}
+
+	StringSetBase& operator=(StringSetBase&& s) noexcept {
+		data_ = std::move(s.data_);
+		limits_ = std::move(s.limits_);
+		external_ = s.external_;
+		base_ = external_ ? s.base_ : data_.data();
+		return *this;
+	}
+
+	// Makes the set a view of strings stored in the layout of data() at ptr, which has to stay valid for the lifetime
+	// of the set. The strings can be modified in place. Adding strings first copies the viewed ones into the set.
+	template<typename It>
+	void assign_external(T* ptr, It lengths_begin, It lengths_end) {
+		limits_.resize(1);
+		for (It i = lengths_begin; i != lengths_end; ++i)
+			reserve(*i);
+		std::vector<T>().swap(data_);
+		base_ = ptr;
+		external_ = true;
+	}
+
 	void finish_reserve()
 	{
 		data_.resize(raw_len() + PERIMETER_PADDING);
 		std::fill(data_.begin() + raw_len(), data_.end(), _pchar);
+		base_ = data_.data();
+		external_ = false;
 	}
 
 	void reserve(size_t n)
@@ -56,27 +105,36 @@ struct StringSetBase
 	}
 
 	void reserve(size_t entries, size_t length) {
+		own();
 		limits_.reserve(entries + 1);
 		data_.reserve(length + 2 * PERIMETER_PADDING + entries * _padding);
+		base_ = data_.data();
 	}
 
 	void clear() {
 		limits_.resize(1);
 		data_.resize(PERIMETER_PADDING);
+		std::fill(data_.begin(), data_.end(), _pchar);
+		base_ = data_.data();
+		external_ = false;
 	}
 
 	void shrink_to_fit() {
 		limits_.shrink_to_fit();
 		data_.shrink_to_fit();
+		if (!external_)
+			base_ = data_.data();
 	}
 
 	template<typename _it>
 	void push_back(_it begin, _it end)
 	{
 		assert(begin <= end);
+		own();
 		limits_.push_back(raw_len() + (end - begin) + _padding);
 		data_.insert(data_.end(), begin, end);
 		data_.insert(data_.end(), _padding, _pchar);
+		base_ = data_.data();
 	}
 
 	void append(const StringSetBase& s) {
@@ -93,19 +151,21 @@ struct StringSetBase
 
 	void fill(size_t n, T v)
 	{
+		own();
 		limits_.push_back(raw_len() + n + _padding);
 		data_.insert(data_.end(), n, v);
 		data_.insert(data_.end(), _padding, _pchar);
+		base_ = data_.data();
 	}
 
 	T* ptr(size_t i)
-	{ return &data_[limits_[i]]; }
+	{ return base_ + limits_[i]; }
 
 	const T* ptr(size_t i) const
-	{ return &data_[limits_[i]]; }
+	{ return base_ + limits_[i]; }
 
 	const T* end(size_t i) const {
-		return &data_[limits_[i + 1] - _padding];
+		return base_ + limits_[i + 1] - _padding;
 	}
 
 	size_t check_idx(size_t i) const
@@ -134,14 +194,18 @@ struct StringSetBase
 		return data_.size() * sizeof(T) + limits_.size() * sizeof(int64_t);
 	}
 
+	bool external() const {
+		return external_;
+	}
+
 	int64_t letters() const
 	{ return raw_len() - size() - PERIMETER_PADDING; }
 
 	T* data(uint64_t p = 0)
-	{ return &data_[p]; }
+	{ return base_ + p; }
 
 	const T* data(uint64_t p = 0) const
-	{ return &data_[p]; }
+	{ return base_ + p; }
 
 	size_t position(const T* p) const
 	{ return p - data(); }
@@ -260,8 +324,23 @@ struct StringSetBase
 
 private:
 
+	// Copies the strings of a set that views external memory into the set before it grows.
+	void own() {
+		if (!external_)
+			return;
+		data_.assign(base_, base_ + raw_len());
+		base_ = data_.data();
+		external_ = false;
+	}
+
+	size_t data_size() const {
+		return external_ ? size_t(raw_len() + PERIMETER_PADDING) : data_.size();
+	}
+
 	std::vector<T> data_;
 	std::vector<Pos> limits_;
+	T* base_;
+	bool external_;
 
 };
 
@@ -0,0 +1,155 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2016-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string.h>
+#include "taxon_filter_index.h"
+#include "taxonomy_nodes.h"
+#include "sequence_file.h"
+#include "../basic/config.h"
+#include "../util/io/output_file.h"
+#include "../util/system/system.h"
+#include "../lib/mio/mmap.hpp"
+#define _REENTRANT
+#include "../lib/ips4o/ips4o.hpp"
+
+using std::vector;
+using std::pair;
+using std::string;
+using std::runtime_error;
+
+const char* const TaxonFilterIndex::FILE_EXTENSION = ".tfi";
+
+struct TaxonFilterIndex::Header {
+	enum : uint64_t { MAGIC = 0x58444946544e4d44llu };
+	enum { VERSION = 0 };
+	uint64_t magic;
+	uint32_t version, reserved;
+	Key key;
+	int64_t rooted, unrooted;
+};
+
+static size_t align8(size_t n) {
+	return (n + 7) & ~size_t(7);
+}
+
+TaxonFilterIndex::Key::Key():
+	db_size(0),
+	seqs(0),
+	taxon_nodes(0)
+{
+	memset(db_hash, 0, sizeof(db_hash));
+}
+
+bool TaxonFilterIndex::Key::operator==(const Key& k) const {
+	return memcmp(db_hash, k.db_hash, sizeof(db_hash)) == 0 && db_size == k.db_size && seqs == k.seqs && taxon_nodes == k.taxon_nodes;
+}
+
+TaxonFilterIndex::TaxonFilterIndex(const string& file_name):
+	file_(new mio::mmap_source(file_name))
+{
+	const char* p = file_->data();
+	if (file_->size() < sizeof(Header))
+		throw runtime_error("Taxonomy filter index file is truncated: " + file_name);
+	header_ = reinterpret_cast<const Header*>(p);
+	if (header_->magic != Header::MAGIC || header_->version != Header::VERSION)
+		throw runtime_error("Invalid taxonomy filter index file: " + file_name);
+	const size_t rooted = (size_t)header_->rooted, unrooted = (size_t)header_->unrooted,
+		pos_size = align8(rooted * sizeof(int32_t));
+	if (file_->size() != sizeof(Header) + pos_size + (rooted + unrooted) * sizeof(OId) + align8(unrooted * sizeof(TaxId)))
+		throw runtime_error("Taxonomy filter index file is truncated: " + file_name);
+	p += sizeof(Header);
+	pos_ = reinterpret_cast<const int32_t*>(p);
+	p += pos_size;
+	oid_ = reinterpret_cast<const OId*>(p);
+	p += rooted * sizeof(OId);
+	unrooted_oid_ = reinterpret_cast<const OId*>(p);
+	p += unrooted * sizeof(OId);
+	unrooted_taxid_ = reinterpret_cast<const TaxId*>(p);
+	advise_mapping(file_->data(), file_->mapped_length(), MmapAccess::RANDOM);
+}
+
+TaxonFilterIndex::~TaxonFilterIndex()
+{}
+
+const TaxonFilterIndex::Key& TaxonFilterIndex::key() const {
+	return header_->key;
+}
+
+void TaxonFilterIndex::set_contained(BitVector& v, const std::set<TaxId>& filter, TaxonomyNodes& nodes) const {
+	const int32_t* end = pos_ + header_->rooted;
+	for (TaxId taxid : filter) {
+		const pair<int32_t, int32_t> r = nodes.tour_range(taxid);
+		if (r.first < 0)
+			continue;
+		const int32_t* begin = std::lower_bound(pos_, end, r.first), * last = std::upper_bound(begin, end, r.second);
+		for (const int32_t* i = begin; i < last; ++i)
+			v.set(oid_[i - pos_]);
+	}
+	for (int64_t i = 0; i < header_->unrooted; ++i)
+		if (nodes.contained(unrooted_taxid_[i], filter))
+			v.set(unrooted_oid_[i]);
+}
+
+void TaxonFilterIndex::build(const string& file_name, const Key& key, const SequenceFile& db, const TaxonomyNodes& nodes) {
+	vector<pair<int32_t, OId>> rooted;
+	vector<pair<OId, TaxId>> unrooted;
+	for (OId i = 0; i < db.sequence_count(); ++i)
+		for (TaxId t : db.taxids(i)) {
+			const int32_t pos = nodes.tour_range(t).first;
+			if (pos >= 0)
+				rooted.emplace_back(pos, i);
+			else
+				unrooted.emplace_back(i, t);
+		}
+	ips4o::parallel::sort(rooted.begin(), rooted.end(), std::less<pair<int32_t, OId>>(), config.threads_);
+
+	Header header;
+	header.magic = Header::MAGIC;
+	header.version = Header::VERSION;
+	header.reserved = 0;
+	header.key = key;
+	header.rooted = (int64_t)rooted.size();
+	header.unrooted = (int64_t)unrooted.size();
+
+	std::random_device rd;
+	const string tmp_name = file_name + ".tmp" + std::to_string(rd());
+	OutputFile out(tmp_name);
+	const char zero[8] = {};
+	out.write_raw((const char*)&header, sizeof(header));
+	for (const auto& p : rooted)
+		out.write(p.first);
+	out.write_raw(zero, align8(rooted.size() * sizeof(int32_t)) - rooted.size() * sizeof(int32_t));
+	for (const auto& p : rooted)
+		out.write(p.second);
+	for (const auto& p : unrooted)
+		out.write(p.first);
+	for (const auto& p : unrooted)
+		out.write(p.second);
+	out.write_raw(zero, align8(unrooted.size() * sizeof(TaxId)) - unrooted.size() * sizeof(TaxId));
+	out.close();
+	if (std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+		std::remove(tmp_name.c_str());
+		throw runtime_error("Error writing taxonomy filter index file: " + file_name);
+	}
+}
@@ -0,0 +1,68 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2016-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <memory>
+#include <set>
+#include <string>
+#include "../basic/value.h"
+#include "../util/data_structures/bit_vector.h"
+#include "../lib/mio/forward.h"
+
+struct SequenceFile;
+struct TaxonomyNodes;
+
+// Sidecar index for taxonomic filtering of a database. Stores the (OId, taxon id) pairs of the taxon
+// list sorted by the position of the taxon in the Euler tour of the taxonomy, so that the sequences
+// assigned to the subtree of a node form a contiguous range that is found by binary search.
+// Pairs whose taxon is not connected to the root are stored separately and checked by walking the tree.
+struct TaxonFilterIndex {
+
+	struct Key {
+		Key();
+		char db_hash[16];
+		uint64_t db_size;
+		int64_t seqs;
+		uint64_t taxon_nodes;
+		bool operator==(const Key& k) const;
+	};
+
+	TaxonFilterIndex(const std::string& file_name);
+	~TaxonFilterIndex();
+	const Key& key() const;
+	// Sets the bits of the sequences that have a taxon id contained in the subtree of a taxon in filter.
+	void set_contained(BitVector& v, const std::set<TaxId>& filter, TaxonomyNodes& nodes) const;
+	static void build(const std::string& file_name, const Key& key, const SequenceFile& db, const TaxonomyNodes& nodes);
+
+	static const char* const FILE_EXTENSION;
+
+private:
+
+	struct Header;
+
+	std::unique_ptr<mio::mmap_source> file_;
+	const Header* header_;
+	const int32_t* pos_;
+	const OId* oid_;
+	const OId* unrooted_oid_;
+	const TaxId* unrooted_taxid_;
+
+};
@@ -74,6 +74,7 @@ TaxonomyNodes::TaxonomyNodes(Deserializer &in, uint32_t db_build)
 		in.read(rank_.data(), rank_.size());
 	}
 	init_cache();
+	init_lca();
 }
 
 void TaxonomyNodes::init_cache() {
@@ -81,7 +82,155 @@ void TaxonomyNodes::init_cache() {
 	contained_.insert(contained_.end(), parent_.size(), false);
 }
 
+void TaxonomyNodes::init_lca() {
+	const int32_t n = (int32_t)parent_.size();
+	if (n < 2)
+		return;
+	vector<int32_t> child_begin(n + 1, 0), children;
+	for (int32_t i = 2; i < n; ++i)
+		if (parent_[i] > 0 && (int32_t)parent_[i] < n && (int32_t)parent_[i] != i)
+			++child_begin[parent_[i] + 1];
+	for (int32_t i = 0; i < n; ++i)
+		child_begin[i + 1] += child_begin[i];
+	children.resize(child_begin[n]);
+	vector<int32_t> fill(child_begin.begin(), child_begin.end() - 1);
+	for (int32_t i = 2; i < n; ++i)
+		if (parent_[i] > 0 && (int32_t)parent_[i] < n && (int32_t)parent_[i] != i)
+			children[fill[parent_[i]]++] = i;
+
+	first_.assign(n, -1);
+	last_.assign(n, -1);
+	euler_node_.reserve(2 * children.size() + 1);
+	euler_depth_.reserve(2 * children.size() + 1);
+	vector<pair<int32_t, int32_t>> stack;
+	stack.emplace_back(1, child_begin[1]);
+	first_[1] = 0;
+	euler_node_.push_back(1);
+	euler_depth_.push_back(0);
+	while (!stack.empty()) {
+		const int32_t node = stack.back().first;
+		if (stack.back().second < child_begin[node + 1]) {
+			const int32_t c = children[stack.back().second++];
+			first_[c] = (int32_t)euler_node_.size();
+			euler_node_.push_back(c);
+			euler_depth_.push_back((int32_t)stack.size());
+			stack.emplace_back(c, child_begin[c]);
+		}
+		else {
+			last_[node] = (int32_t)euler_node_.size() - 1;
+			stack.pop_back();
+			if (!stack.empty()) {
+				euler_node_.push_back(stack.back().first);
+				euler_depth_.push_back((int32_t)stack.size() - 1);
+			}
+		}
+	}
+
+	const int32_t m = (int32_t)euler_node_.size(), blocks = (m + LCA_BLOCK - 1) / LCA_BLOCK;
+	block_min_.emplace_back(blocks);
+	for (int32_t b = 0; b < blocks; ++b) {
+		int32_t k = b * LCA_BLOCK;
+		for (int32_t i = k + 1; i < std::min(m, (b + 1) * LCA_BLOCK); ++i)
+			if (euler_depth_[i] < euler_depth_[k])
+				k = i;
+		block_min_[0][b] = k;
+	}
+	for (int32_t level = 1; (1 << level) <= blocks; ++level) {
+		const vector<int32_t>& prev = block_min_[level - 1];
+		vector<int32_t> v(blocks - (1 << level) + 1);
+		for (size_t b = 0; b < v.size(); ++b) {
+			const int32_t x = prev[b], y = prev[b + (1 << (level - 1))];
+			v[b] = euler_depth_[y] < euler_depth_[x] ? y : x;
+		}
+		block_min_.push_back(std::move(v));
+	}
+}
+
+int32_t TaxonomyNodes::euler_min(int32_t i, int32_t j) const {
+	auto scan = [this](int32_t begin, int32_t end, int32_t k) {
+		for (int32_t x = begin; x < end; ++x)
+			if (euler_depth_[x] < euler_depth_[k])
+				k = x;
+		return k;
+	};
+	const int32_t bi = i / LCA_BLOCK, bj = j / LCA_BLOCK;
+	if (bi == bj)
+		return scan(i + 1, j + 1, i);
+	int32_t k = scan(i + 1, (bi + 1) * LCA_BLOCK, i);
+	k = scan(bj * LCA_BLOCK, j + 1, k);
+	if (bj - bi > 1) {
+		int32_t level = 0;
+		while ((2 << level) <= bj - bi - 1)
+			++level;
+		const int32_t x = block_min_[level][bi + 1], y = block_min_[level][bj - (1 << level)];
+		const int32_t z = euler_depth_[y] < euler_depth_[x] ? y : x;
+		if (euler_depth_[z] < euler_depth_[k])
+			k = z;
+	}
+	return k;
+}
+
+bool TaxonomyNodes::is_ancestor(TaxId ancestor, TaxId taxid) const {
+	if (first_.empty() || taxid < 0 || taxid >= (TaxId)first_.size() || first_[taxid] < 0) {
+		for (int n = 0; taxid > 1 && taxid != ancestor && n <= 64; ++n)
+			taxid = get_parent(taxid);
+		return taxid == ancestor;
+	}
+	if (ancestor < 0 || ancestor >= (TaxId)first_.size() || first_[ancestor] < 0)
+		return false;
+	return first_[ancestor] <= first_[taxid] && last_[taxid] <= last_[ancestor];
+}
+
+// The LCA of a set of nodes is the shallowest node of the tour between their first occurrences, so the whole set takes
+// one range minimum query. As in the pairwise call, nodes not connected to the root are ignored unless no other node is.
+TaxId TaxonomyNodes::get_lca(const vector<TaxId>& taxids, TaxId init) const {
+	int32_t lo = -1, hi = -1;
+	TaxId any = init;
+	auto add = [&](TaxId t) {
+		if (t == 0)
+			return true;
+		if (t < 0 || t >= (TaxId)first_.size())
+			return false;
+		if (any == 0)
+			any = t;
+		const int32_t f = first_[t];
+		if (f >= 0) {
+			lo = lo < 0 ? f : std::min(lo, f);
+			hi = std::max(hi, f);
+		}
+		return true;
+	};
+	bool indexed = add(init);
+	for (auto i = taxids.cbegin(); indexed && i != taxids.cend(); ++i)
+		indexed = add(*i);
+	if (!indexed) {
+		for (TaxId t : taxids)
+			init = get_lca(init, t);
+		return init;
+	}
+	return lo < 0 ? any : euler_node_[euler_min(lo, hi)];
+}
+
 unsigned TaxonomyNodes::get_lca(unsigned t1, unsigned t2) const
+{
+	if (t1 == t2 || t2 == 0)
+		return t1;
+	if (t1 == 0)
+		return t2;
+	if (first_.empty())
+		return get_lca_walk(t1, t2);
+	if (t1 >= parent_.size() || t2 >= parent_.size())
+		return get_lca_walk(t1, t2);
+	// Nodes not connected to the root resolve to the other node, as in the path walk.
+	if (first_[t2] < 0)
+		return t1;
+	if (first_[t1] < 0)
+		return t2;
+	const int32_t i = first_[t1], j = first_[t2];
+	return euler_node_[euler_min(std::min(i, j), std::max(i, j))];
+}
+
+unsigned TaxonomyNodes::get_lca_walk(unsigned t1, unsigned t2) const
 {
 	static const int max = 64;
 	if (t1 == t2 || t2 == 0)
@@ -71,6 +71,18 @@ struct TaxonomyNodes
 	unsigned rank_taxid(unsigned taxid, Rank rank) const;
 	std::set<TaxId> rank_taxid(const std::vector<TaxId> &taxid, Rank rank) const;
 	unsigned get_lca(unsigned t1, unsigned t2) const;
+	TaxId get_lca(const std::vector<TaxId>& taxids, TaxId init = 0) const;
+	bool is_ancestor(TaxId ancestor, TaxId taxid) const;
+	std::pair<int32_t, int32_t> tour_range(TaxId taxid) const
+	{
+		if (taxid < 0 || taxid >= (TaxId)first_.size())
+			return { -1, -1 };
+		return { first_[taxid], last_[taxid] };
+	}
+	size_t size() const
+	{
+		return parent_.size();
+	}
 	bool contained(TaxId query, const std::set<TaxId> &filter);
 	bool contained(const std::vector<TaxId>& query, const std::set<TaxId> &filter);
 
@@ -82,9 +94,20 @@ private:
 		contained_[taxon_id] = contained;
 	}
 	void init_cache();
+	void init_lca();
+	unsigned get_lca_walk(unsigned t1, unsigned t2) const;
+	int32_t euler_min(int32_t i, int32_t j) const;
 
 	std::vector<TaxId> parent_;
 	std::vector<Rank> rank_;
 	std::vector<bool> cached_, contained_;
 
+	// LCA index: Euler tour of the tree rooted at taxon 1 with a sparse table over the depth minima
+	// of fixed size blocks. first_/last_ map a taxon id to its first/last position in the tour
+	// (-1 if the node is not connected to the root).
+	enum { LCA_BLOCK = 32 };
+	std::vector<int32_t> first_, last_, euler_depth_;
+	std::vector<TaxId> euler_node_;
+	std::vector<std::vector<int32_t>> block_min_;
+
 };
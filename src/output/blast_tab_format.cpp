@@ -217,300 +217,306 @@ void Blast_tab_format::print_match(const HspContext& r, Output::Info& info)
 {
 	TextBuffer& out = info.out;
 	for (auto i = fields.cbegin(); i != fields.cend(); ++i) {
-		switch (*i) {
-		case 0:
-			out.write_until(r.query_title.c_str(), Util::Seq::id_delimiters);
-			break;
-		case 4:
-			out << r.query.source().length();
-			break;
-		case 5:
-			print_title(out, r.target_title.c_str(), false, false, "<>");
-			break;
-		case 6:
-			print_title(out, r.target_title.c_str(), false, true, "<>");
-			break;
-		case 12:
-			out << r.subject_len;
-			break;
-		case 13:
-			out << r.oriented_query_range().begin_ + 1;
-			break;
-		case 14:
-			out << r.oriented_query_range().end_ + 1;
-			break;
-		case 15:
-			out << r.subject_range().begin_ + 1;
-			break;
-		case 16:
-			out << r.subject_range().end_;
-			break;
-		case 17:
-			r.query.source().print(out, r.query_source_range().begin_, r.query_source_range().end_, input_value_traits);
-			break;
-		case 18:
-		{
-			vector<Letter> seq;
-			seq.reserve(r.subject_range().length());
-			for (HspContext::Iterator j = r.begin(); j.good(); ++j)
-				if (!(j.op() == op_insertion))
-					seq.push_back(j.subject());
-			out << Sequence(seq);
-			break;
-		}
-		case 19:
-			out.print_e(r.evalue());
-			break;
-		case 20:
-			out << r.bit_score();
-			break;
-		case 21:
-			out << r.score();
-			break;
-		case 22:
-			out << r.length();
-			break;
-		case 23:
-			out << r.id_percent();
-			break;
-		case 24:
-			out << r.identities();
-			break;
-		case 25:
-			out << r.mismatches();
-			break;
-		case 26:
-			out << r.positives();
-			break;
-		case 27:
-			out << r.gap_openings();
-			break;
-		case 28:
-			out << r.gaps();
-			break;
-		case 29:
-			out << (double)r.positives() * 100.0 / r.length();
-			break;
-		case 31:
-			out << r.blast_query_frame();
-			break;
-		case 33:
-		{
-			unsigned n_matches = 0;
-			for (HspContext::Iterator i = r.begin(); i.good(); ++i) {
-				switch (i.op()) {
-				case op_match:
-					++n_matches;
-					break;
-				case op_substitution:
-				case op_frameshift_forward:
-				case op_frameshift_reverse:
-					if (n_matches > 0) {
-						out << n_matches;
-						n_matches = 0;
-					}
-					out << i.query_char() << i.subject_char();
-					break;
-				case op_insertion:
-					if (n_matches > 0) {
-						out << n_matches;
-						n_matches = 0;
-					}
-					out << i.query_char() << '-';
-					break;
-				case op_deletion:
-					if (n_matches > 0) {
-						out << n_matches;
-						n_matches = 0;
-					}
-					out << '-' << i.subject_char();
-					break;
+		print_field(*i, r, info);
+		if (i < fields.end() - 1)
+			out << '\t';
+	}
+	out << '\n';
+}
+
+void Blast_tab_format::print_field(int64_t field, const HspContext& r, Output::Info& info)
+{
+	TextBuffer& out = info.out;
+	switch (field) {
+	case 0:
+		out.write_until(r.query_title.c_str(), Util::Seq::id_delimiters);
+		break;
+	case 4:
+		out << r.query.source().length();
+		break;
+	case 5:
+		print_title(out, r.target_title.c_str(), false, false, "<>");
+		break;
+	case 6:
+		print_title(out, r.target_title.c_str(), false, true, "<>");
+		break;
+	case 12:
+		out << r.subject_len;
+		break;
+	case 13:
+		out << r.oriented_query_range().begin_ + 1;
+		break;
+	case 14:
+		out << r.oriented_query_range().end_ + 1;
+		break;
+	case 15:
+		out << r.subject_range().begin_ + 1;
+		break;
+	case 16:
+		out << r.subject_range().end_;
+		break;
+	case 17:
+		r.query.source().print(out, r.query_source_range().begin_, r.query_source_range().end_, input_value_traits);
+		break;
+	case 18:
+	{
+		vector<Letter> seq;
+		seq.reserve(r.subject_range().length());
+		for (HspContext::Iterator j = r.begin(); j.good(); ++j)
+			if (!(j.op() == op_insertion))
+				seq.push_back(j.subject());
+		out << Sequence(seq);
+		break;
+	}
+	case 19:
+		out.print_e(r.evalue());
+		break;
+	case 20:
+		out << r.bit_score();
+		break;
+	case 21:
+		out << r.score();
+		break;
+	case 22:
+		out << r.length();
+		break;
+	case 23:
+		out << r.id_percent();
+		break;
+	case 24:
+		out << r.identities();
+		break;
+	case 25:
+		out << r.mismatches();
+		break;
+	case 26:
+		out << r.positives();
+		break;
+	case 27:
+		out << r.gap_openings();
+		break;
+	case 28:
+		out << r.gaps();
+		break;
+	case 29:
+		out << (double)r.positives() * 100.0 / r.length();
+		break;
+	case 31:
+		out << r.blast_query_frame();
+		break;
+	case 33:
+	{
+		unsigned n_matches = 0;
+		for (HspContext::Iterator i = r.begin(); i.good(); ++i) {
+			switch (i.op()) {
+			case op_match:
+				++n_matches;
+				break;
+			case op_substitution:
+			case op_frameshift_forward:
+			case op_frameshift_reverse:
+				if (n_matches > 0) {
+					out << n_matches;
+					n_matches = 0;
+				}
+				out << i.query_char() << i.subject_char();
+				break;
+			case op_insertion:
+				if (n_matches > 0) {
+					out << n_matches;
+					n_matches = 0;
+				}
+				out << i.query_char() << '-';
+				break;
+			case op_deletion:
+				if (n_matches > 0) {
+					out << n_matches;
+					n_matches = 0;
 				}
+				out << '-' << i.subject_char();
+				break;
 			}
-			if (n_matches > 0)
-				out << n_matches;
 		}
+		if (n_matches > 0)
+			out << n_matches;
+	}
+	break;
+	case 34:
+		print_staxids(out, r.subject_oid, *info.db);
 		break;
-		case 34:
-			print_staxids(out, r.subject_oid, *info.db);
-			break;
-		case 35: {
-			const vector<TaxId> tax_id = info.db->taxids(r.subject_oid);
-			print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
-			break;
-		}
-		case 38: {
-			const set<TaxId> tax_id = info.db->taxon_nodes().rank_taxid(info.db->taxids(r.subject_oid), Rank::superkingdom);
-			print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
-			break;
-		}
-		case 39:
-			print_title(out, r.target_title.c_str(), true, false, "<>");
-			break;
-		case 40:
-			print_title(out, r.target_title.c_str(), true, true, "<>");
-			break;
-		case 43:
-			out << r.qcovhsp();
-			break;
-		case 45:
-			out << r.query_title;
-			break;
-		case 46:
-			out << 0;
-			break;
-		case 47:
-			out << 0;
-			break;
-		case 48:
-			out << r.subject_seq;
-			break;
-		case 49: {
-			if (strlen(info.query.qual) == 0) {
-				out << '*';
-				break;
-			}
-			out << string(info.query.qual + r.query_source_range().begin_, info.query.qual + r.query_source_range().end_).c_str();
+	case 35: {
+		const vector<TaxId> tax_id = info.db->taxids(r.subject_oid);
+		print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
+		break;
+	}
+	case 38: {
+		const set<TaxId> tax_id = info.db->taxon_nodes().rank_taxid(info.db->taxids(r.subject_oid), Rank::superkingdom);
+		print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
+		break;
+	}
+	case 39:
+		print_title(out, r.target_title.c_str(), true, false, "<>");
+		break;
+	case 40:
+		print_title(out, r.target_title.c_str(), true, true, "<>");
+		break;
+	case 43:
+		out << r.qcovhsp();
+		break;
+	case 45:
+		out << r.query_title;
+		break;
+	case 46:
+		out << 0;
+		break;
+	case 47:
+		out << 0;
+		break;
+	case 48:
+		out << r.subject_seq;
+		break;
+	case 49: {
+		if (strlen(info.query.qual) == 0) {
+			out << '*';
 			break;
 		}
-		case 50:
-			out << r.query_oid;
-			break;
-		case 51:
-			out << r.subject_oid;
-			break;
-		case 52:
-			out << r.scovhsp();
-			break;
-		case 53:
-			out << strlen(info.query.qual) ? info.query.qual : "*";
-			break;
-		case 54:
-			r.query.source().print(out, input_value_traits);
-			break;
-		case 55:
-			for (HspContext::Iterator i = r.begin(); i.good(); ++i)
-				out << i.query_char();
-			break;
-		case 56:
-			for (HspContext::Iterator i = r.begin(); i.good(); ++i)
-				out << i.subject_char();
-			break;
-		case 57:
-			if (align_mode.query_translated)
-				out << ((r.blast_query_frame() > 0) ? '+' : '-');
-			else
-				out << '+';
-			break;
-		case 58:
-			print_cigar(r, out);
-			break;
-		case 59: {
-			const set<TaxId> tax_id = info.db->taxon_nodes().rank_taxid(info.db->taxids(r.subject_oid), Rank::kingdom);
-			print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
+		out << string(info.query.qual + r.query_source_range().begin_, info.query.qual + r.query_source_range().end_).c_str();
+		break;
+	}
+	case 50:
+		out << r.query_oid;
+		break;
+	case 51:
+		out << r.subject_oid;
+		break;
+	case 52:
+		out << r.scovhsp();
+		break;
+	case 53:
+		out << strlen(info.query.qual) ? info.query.qual : "*";
+		break;
+	case 54:
+		r.query.source().print(out, input_value_traits);
+		break;
+	case 55:
+		for (HspContext::Iterator i = r.begin(); i.good(); ++i)
+			out << i.query_char();
+		break;
+	case 56:
+		for (HspContext::Iterator i = r.begin(); i.good(); ++i)
+			out << i.subject_char();
+		break;
+	case 57:
+		if (align_mode.query_translated)
+			out << ((r.blast_query_frame() > 0) ? '+' : '-');
+		else
+			out << '+';
+		break;
+	case 58:
+		print_cigar(r, out);
+		break;
+	case 59: {
+		const set<TaxId> tax_id = info.db->taxon_nodes().rank_taxid(info.db->taxids(r.subject_oid), Rank::kingdom);
+		print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
+		break;
+	}
+	case 60: {
+		const set<TaxId> tax_id = info.db->taxon_nodes().rank_taxid(info.db->taxids(r.subject_oid), Rank::phylum);
+		print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
+		break;
+	}
+	case 61:
+		out << r.ungapped_score;
+		break;
+	case 62: {
+		if (config.query_file.size() == 2) {
+			info.query.mate_seq.print(out, input_value_traits);
 			break;
 		}
-		case 60: {
-			const set<TaxId> tax_id = info.db->taxon_nodes().rank_taxid(info.db->taxids(r.subject_oid), Rank::phylum);
-			print_taxon_names(tax_id.begin(), tax_id.end(), *info.db, out);
+		else {
+			out << '*';
 			break;
 		}
-		case 61:
-			out << r.ungapped_score;
-			break;
-		case 62: {
-			if (config.query_file.size() == 2) {
-				info.query.mate_seq.print(out, input_value_traits);
-				break;
-			}
-			else {
-				out << '*';
-				break;
-			}
+	}
+	case 63: {
+		if (config.frame_shift) {
+			vector<Letter> seq;
+			seq.reserve(r.query_range().length());
+			for (HspContext::Iterator j = r.begin(); j.good(); ++j)
+				if (j.op() != op_deletion && j.op() != op_frameshift_forward && j.op() != op_frameshift_reverse)
+					seq.push_back(j.query());
+			out << Sequence(seq);
 		}
-		case 63: {
-			if (config.frame_shift) {
-				vector<Letter> seq;
-				seq.reserve(r.query_range().length());
-				for (HspContext::Iterator j = r.begin(); j.good(); ++j)
-					if (j.op() != op_deletion && j.op() != op_frameshift_forward && j.op() != op_frameshift_reverse)
-						seq.push_back(j.query());
-				out << Sequence(seq);
-			}
-			else {
-				r.query.index(r.frame()).print(out, r.query_range().begin_, r.query_range().end_, amino_acid_traits);
-			}
-			break;
+		else {
+			r.query.index(r.frame()).print(out, r.query_range().begin_, r.query_range().end_, amino_acid_traits);
 		}
-		case 64: {
-			string s;
-			size_t n = 0;
-			for (HspContext::Iterator j = r.begin(); j.good(); ++j) {
-				if (j.op() == op_deletion || j.op() == op_insertion) {
-					if (!s.empty()) {
-						if (n++ > 0) out << '\t';
-						out << s;
-						s.clear();
-					}
+		break;
+	}
+	case 64: {
+		string s;
+		size_t n = 0;
+		for (HspContext::Iterator j = r.begin(); j.good(); ++j) {
+			if (j.op() == op_deletion || j.op() == op_insertion) {
+				if (!s.empty()) {
+					if (n++ > 0) out << '\t';
+					out << s;
+					s.clear();
 				}
-				else
-					if (j.query() < 20 && j.subject() < 20) {
-						if (Reduction::reduction(j.query()) == Reduction::reduction(j.subject()))
-							s += '1';
-						else
-							s += '0';
-					}
+			}
+			else
+				if (j.query() < 20 && j.subject() < 20) {
+					if (Reduction::reduction(j.query()) == Reduction::reduction(j.subject()))
+						s += '1';
 					else
 						s += '0';
-			}
-			if (n > 0) out << '\t';
-			out << s;
-			break;
+				}
+				else
+					s += '0';
 		}
-		case 71:
-			out << r.approx_id();
-			break;
-		case 72:
-			out << r.corrected_bit_score();
-			break;
+		if (n > 0) out << '\t';
+		out << s;
+		break;
+	}
+	case 71:
+		out << r.approx_id();
+		break;
+	case 72:
+		out << r.corrected_bit_score();
+		break;
 #ifdef EXTRA
-		case 65:
-			out.print_d(r.bit_score() / score_matrix.bitscore(self_score(r.subject_seq)));
-			break;
-		case 66:
-			out << r.hsp_num;
-			break;
-		case 67:
-			out << r.bit_score() / std::max(r.query_self_aln_score, r.target_self_aln_score) * 100;
-			break;
-		case 68:
-			out << (double)r.identities() / std::max(r.query.index(r.frame()).length(), r.subject_len) * 100;
-			break;
-		case 69:
-			out << info.stats.extension_count;
-			break;
-		case 70:
-			out.print_e(score_matrix.bitscore(r.query[Frame(0)].length() < r.subject_len ?
-				nw_semiglobal(r.query[Frame(0)], r.subject_seq)
-				: nw_semiglobal(r.subject_seq, r.query[Frame(0)])));
-			break;
-		case 73:
-			out.print_e(r.evalue() == 0 ? r.bit_score() : -r.evalue());
-			break;
-		case 74:
-			out << r.reserved1();
-			break;
-		case 75:
-			out << r.reserved2();
-			break;
+	case 65:
+		out.print_d(r.bit_score() / score_matrix.bitscore(self_score(r.subject_seq)));
+		break;
+	case 66:
+		out << r.hsp_num;
+		break;
+	case 67:
+		out << r.bit_score() / std::max(r.query_self_aln_score, r.target_self_aln_score) * 100;
+		break;
+	case 68:
+		out << (double)r.identities() / std::max(r.query.index(r.frame()).length(), r.subject_len) * 100;
+		break;
+	case 69:
+		out << info.stats.extension_count;
+		break;
+	case 70:
+		out.print_e(score_matrix.bitscore(r.query[Frame(0)].length() < r.subject_len ?
+			nw_semiglobal(r.query[Frame(0)], r.subject_seq)
+			: nw_semiglobal(r.subject_seq, r.query[Frame(0)])));
+		break;
+	case 73:
+		out.print_e(r.evalue() == 0 ? r.bit_score() : -r.evalue());
+		break;
+	case 74:
+		out << r.reserved1();
+		break;
+	case 75:
+		out << r.reserved2();
+		break;
 #endif
-		default:
-			throw std::runtime_error(string("Invalid output field: ") + field_def[*i].key);
-		}
-		if (i < fields.end() - 1)
-			out << '\t';
+	default:
+		throw std::runtime_error(string("Invalid output field: ") + field_def[field].key);
 	}
-	out << '\n';
 }
 
 void Blast_tab_format::print_query_intro(Output::Info& info) const
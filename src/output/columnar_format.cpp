@@ -0,0 +1,146 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <string.h>
+#include "output_format.h"
+
+using std::vector;
+
+static ColumnarWriter::Type column_type(int64_t field) {
+	switch (field) {
+	case 0:
+	case 5:
+		return ColumnarWriter::Type::DICT;
+	case 4:
+	case 12:
+	case 13:
+	case 14:
+	case 15:
+	case 16:
+	case 21:
+	case 22:
+	case 24:
+	case 25:
+	case 26:
+	case 27:
+	case 28:
+		return ColumnarWriter::Type::INT64;
+	case 19:
+	case 20:
+	case 23:
+	case 29:
+	case 43:
+	case 52:
+	case 72:
+		return ColumnarWriter::Type::DOUBLE;
+	default:
+		return ColumnarWriter::Type::STRING;
+	}
+}
+
+Columnar_format::Columnar_format() :
+	Blast_tab_format()
+{
+	code = columnar;
+}
+
+void Columnar_format::print_match(const HspContext& r, Output::Info& info)
+{
+	TextBuffer& out = info.out;
+	for (int64_t f : fields) {
+		switch (f) {
+		case 4:
+			out.write((int64_t)r.query.source().length());
+			break;
+		case 12:
+			out.write((int64_t)r.subject_len);
+			break;
+		case 13:
+			out.write((int64_t)r.oriented_query_range().begin_ + 1);
+			break;
+		case 14:
+			out.write((int64_t)r.oriented_query_range().end_ + 1);
+			break;
+		case 15:
+			out.write((int64_t)r.subject_range().begin_ + 1);
+			break;
+		case 16:
+			out.write((int64_t)r.subject_range().end_);
+			break;
+		case 19:
+			out.write(r.evalue());
+			break;
+		case 20:
+			out.write(r.bit_score());
+			break;
+		case 21:
+			out.write((int64_t)r.score());
+			break;
+		case 22:
+			out.write((int64_t)r.length());
+			break;
+		case 23:
+			out.write(r.id_percent());
+			break;
+		case 24:
+			out.write((int64_t)r.identities());
+			break;
+		case 25:
+			out.write((int64_t)r.mismatches());
+			break;
+		case 26:
+			out.write((int64_t)r.positives());
+			break;
+		case 27:
+			out.write((int64_t)r.gap_openings());
+			break;
+		case 28:
+			out.write((int64_t)r.gaps());
+			break;
+		case 29:
+			out.write((double)r.positives() * 100.0 / r.length());
+			break;
+		case 43:
+			out.write((double)r.qcovhsp());
+			break;
+		case 52:
+			out.write((double)r.scovhsp());
+			break;
+		case 72:
+			out.write((double)r.corrected_bit_score());
+			break;
+		default: {
+			const size_t pos = out.size();
+			out.write((uint32_t)0);
+			print_field(f, r, info);
+			const uint32_t len = uint32_t(out.size() - pos - sizeof(uint32_t));
+			memcpy(out.data() + pos, &len, sizeof(len));
+		}
+		}
+	}
+}
+
+vector<ColumnarWriter::Column> Columnar_format::columns() const {
+	vector<ColumnarWriter::Column> v;
+	for (int64_t f : fields)
+		v.push_back({ field_def[f].key, column_type(f) });
+	return v;
+}
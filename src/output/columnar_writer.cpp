@@ -0,0 +1,239 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <zlib.h>
+#include "columnar_writer.h"
+#include "../basic/config.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+static const char MAGIC[8] = { 'D', 'M', 'N', 'D', 'C', 'O', 'L', '\1' };
+static const uint32_t VERSION = 2;
+static const uint8_t ZLIB_COMPRESSION = 1;
+
+template<typename T>
+static void update_range(const vector<char>& data, char* min, char* max) {
+	const T* begin = reinterpret_cast<const T*>(data.data()), * end = begin + data.size() / sizeof(T);
+	T lo = 0, hi = 0;
+	if (begin < end) {
+		const auto r = std::minmax_element(begin, end);
+		lo = *r.first;
+		hi = *r.second;
+	}
+	memcpy(min, &lo, sizeof(T));
+	memcpy(max, &hi, sizeof(T));
+}
+
+ColumnarWriter::ColumnarWriter(const string& file_name, const vector<Column>& columns) :
+	columns_(columns),
+	max_pending_((size_t)std::max(config.threads_, 1)),
+	out_(file_name),
+	pos_(0),
+	rows_(0),
+	raw_(columns.size()),
+	dict_(columns.size()),
+	finalized_(false)
+{
+	out_.write_raw(MAGIC, sizeof(MAGIC));
+	pos_ += sizeof(MAGIC);
+	for (auto& v : raw_)
+		v.reserve(CHUNK_ROWS * sizeof(int64_t));
+}
+
+size_t ColumnarWriter::parse_row(const char* ptr, const char* end) {
+	const char* p = ptr;
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		if (columns_[i].type == Type::DICT || columns_[i].type == Type::STRING) {
+			uint32_t len;
+			if (end - p < (ptrdiff_t)sizeof(len))
+				return 0;
+			memcpy(&len, p, sizeof(len));
+			if (end - p < (ptrdiff_t)(sizeof(len) + len))
+				return 0;
+			p += sizeof(len) + len;
+		}
+		else {
+			if (end - p < 8)
+				return 0;
+			p += 8;
+		}
+	}
+	p = ptr;
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		vector<char>& raw = raw_[i];
+		if (columns_[i].type == Type::STRING) {
+			uint32_t len;
+			memcpy(&len, p, sizeof(len));
+			raw.insert(raw.end(), p, p + sizeof(len) + len);
+			p += sizeof(len) + len;
+		}
+		else if (columns_[i].type == Type::DICT) {
+			uint32_t len;
+			memcpy(&len, p, sizeof(len));
+			p += sizeof(len);
+			const auto it = dict_[i].emplace(string(p, len), (uint32_t)dict_[i].size()).first;
+			p += len;
+			raw.insert(raw.end(), reinterpret_cast<const char*>(&it->second), reinterpret_cast<const char*>(&it->second) + sizeof(uint32_t));
+		}
+		else {
+			raw.insert(raw.end(), p, p + 8);
+			p += 8;
+		}
+	}
+	if (++rows_ == CHUNK_ROWS)
+		dispatch();
+	return p - ptr;
+}
+
+void ColumnarWriter::consume(const char* ptr, size_t n) {
+	const char* end = ptr + n;
+	if (!pending_.empty()) {
+		pending_.insert(pending_.end(), ptr, end);
+		const char* p = pending_.data(), *pend = p + pending_.size();
+		size_t k;
+		while ((k = parse_row(p, pend)) > 0)
+			p += k;
+		pending_.erase(pending_.begin(), pending_.begin() + (p - pending_.data()));
+		return;
+	}
+	size_t k;
+	while (ptr < end && (k = parse_row(ptr, end)) > 0)
+		ptr += k;
+	pending_.assign(ptr, end);
+}
+
+ColumnarWriter::Chunk ColumnarWriter::compress(vector<vector<char>>& raw, uint64_t rows, const vector<Column>& columns) {
+	Chunk chunk;
+	chunk.rows = rows;
+	chunk.columns.resize(raw.size());
+	for (size_t i = 0; i < raw.size(); ++i) {
+		ColumnChunk& c = chunk.columns[i];
+		switch (columns[i].type) {
+		case Type::INT64:
+			update_range<int64_t>(raw[i], c.min, c.max);
+			break;
+		case Type::DOUBLE:
+			update_range<double>(raw[i], c.min, c.max);
+			break;
+		case Type::DICT:
+			update_range<uint32_t>(raw[i], c.min, c.max);
+			memset(c.min + sizeof(uint32_t), 0, 4);
+			memset(c.max + sizeof(uint32_t), 0, 4);
+			break;
+		default:
+			memset(c.min, 0, 8);
+			memset(c.max, 0, 8);
+		}
+		uLongf size = compressBound((uLong)raw[i].size());
+		c.data.resize(size);
+		if (compress2(reinterpret_cast<Bytef*>(c.data.data()), &size, reinterpret_cast<const Bytef*>(raw[i].data()), (uLong)raw[i].size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+			throw runtime_error("Error compressing output column.");
+		c.data.resize(size);
+		c.raw_size = raw[i].size();
+		c.size = size;
+		vector<char>().swap(raw[i]);
+	}
+	return chunk;
+}
+
+void ColumnarWriter::dispatch() {
+	if (rows_ == 0)
+		return;
+	if (jobs_.size() >= max_pending_) {
+		Chunk chunk = jobs_.front().get();
+		jobs_.pop_front();
+		commit(chunk);
+	}
+	jobs_.push_back(std::async(std::launch::async, [this](vector<vector<char>> raw, uint64_t rows) { return compress(raw, rows, columns_); }, std::move(raw_), rows_));
+	raw_.assign(columns_.size(), vector<char>());
+	for (auto& v : raw_)
+		v.reserve(CHUNK_ROWS * sizeof(int64_t));
+	rows_ = 0;
+}
+
+void ColumnarWriter::commit(Chunk& chunk) {
+	for (ColumnChunk& c : chunk.columns) {
+		c.offset = pos_;
+		out_.write_raw(c.data.data(), c.data.size());
+		pos_ += c.data.size();
+		vector<char>().swap(c.data);
+	}
+	directory_.push_back(std::move(chunk));
+}
+
+void ColumnarWriter::finalize() {
+	if (finalized_)
+		return;
+	finalized_ = true;
+	if (!pending_.empty())
+		throw runtime_error("Incomplete record in columnar output.");
+	dispatch();
+	while (!jobs_.empty()) {
+		Chunk chunk = jobs_.front().get();
+		jobs_.pop_front();
+		commit(chunk);
+	}
+
+	const uint64_t footer_offset = pos_;
+	out_.write(VERSION);
+	out_.write((uint32_t)columns_.size());
+	for (const Column& c : columns_) {
+		out_.write((uint8_t)c.type);
+		out_.write(ZLIB_COMPRESSION);
+		out_.write_raw(c.name.c_str(), c.name.length() + 1);
+	}
+	out_.write((uint64_t)directory_.size());
+	for (const Chunk& chunk : directory_) {
+		out_.write(chunk.rows);
+		for (const ColumnChunk& c : chunk.columns) {
+			out_.write(c.offset);
+			out_.write(c.size);
+			out_.write(c.raw_size);
+			out_.write_raw(c.min, 8);
+			out_.write_raw(c.max, 8);
+		}
+	}
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		if (columns_[i].type != Type::DICT)
+			continue;
+		vector<const string*> entries(dict_[i].size());
+		for (const auto& e : dict_[i])
+			entries[e.second] = &e.first;
+		out_.write((uint64_t)entries.size());
+		for (const string* s : entries) {
+			out_.write((uint32_t)s->length());
+			out_.write_raw(s->data(), s->length());
+		}
+	}
+	out_.write(footer_offset);
+	out_.write_raw(MAGIC, sizeof(MAGIC));
+	out_.close();
+}
+
+ColumnarWriter::~ColumnarWriter() {
+	for (auto& job : jobs_)
+		job.wait();
+}
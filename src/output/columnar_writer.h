@@ -0,0 +1,94 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../util/io/consumer.h"
+#include "../util/io/output_file.h"
+
+/* Column-chunked binary output (--outfmt col). All numbers are little endian.
+
+   "DMNDCOL\1"                              8 byte magic
+   chunk data                               one zlib stream per column and chunk
+   footer:
+     uint32 version, uint32 column count
+     per column: uint8 type (0 = int64, 1 = double, 2 = dictionary string, 3 = string), uint8 compression (1 = zlib),
+       name (null-terminated)
+     uint64 chunk count
+     per chunk: uint64 rows, per column: uint64 offset, uint64 compressed size, uint64 raw size, 8 byte min, 8 byte max
+     per dictionary string column: uint64 entries, per entry: uint32 length, bytes
+   uint64 footer offset
+   "DMNDCOL\1"
+
+   Int64 and double columns store the values. Dictionary string columns (the sequence ids, which repeat across the
+   hits) store uint32 codes into the dictionary of the column in the footer, other string columns store uint32 length
+   and bytes per value. Min/max are of the type of the column (the codes for dictionary columns, 0 for strings). */
+
+struct ColumnarWriter : public Consumer
+{
+
+	enum class Type : uint8_t { INT64 = 0, DOUBLE = 1, DICT = 2, STRING = 3 };
+	struct Column {
+		std::string name;
+		Type type;
+	};
+
+	ColumnarWriter(const std::string& file_name, const std::vector<Column>& columns);
+	virtual void consume(const char* ptr, size_t n) override;
+	virtual void finalize() override;
+	virtual ~ColumnarWriter();
+
+	static const size_t CHUNK_ROWS = 65536;
+
+private:
+
+	struct ColumnChunk {
+		std::vector<char> data;
+		uint64_t offset, size, raw_size;
+		char min[8], max[8];
+	};
+	struct Chunk {
+		uint64_t rows;
+		std::vector<ColumnChunk> columns;
+	};
+
+	size_t parse_row(const char* ptr, const char* end);
+	void dispatch();
+	void commit(Chunk& chunk);
+	static Chunk compress(std::vector<std::vector<char>>& raw, uint64_t rows, const std::vector<Column>& columns);
+
+	const std::vector<Column> columns_;
+	const size_t max_pending_;
+	OutputFile out_;
+	uint64_t pos_, rows_;
+	std::vector<char> pending_;
+	std::vector<std::vector<char>> raw_;
+	std::vector<std::unordered_map<std::string, uint32_t>> dict_;
+	std::deque<std::future<Chunk>> jobs_;
+	std::vector<Chunk> directory_;
+	bool finalized_;
+
+};
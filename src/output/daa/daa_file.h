@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 #include <string>
 #include <exception>
+#include <algorithm>
 #include "../util/ptr_vector.h"
 #include "../basic/config.h"
 #include "../basic/const.h"
@@ -89,7 +90,7 @@ struct DAA_header2
 		strcpy(this->score_matrix, score_matrix.c_str());
 	}
 	DAA_header2(const DAA_file& f);
-	typedef enum { empty = 0, alignments = 1, ref_names = 2, ref_lengths = 3 } Block_type;
+	typedef enum { empty = 0, alignments = 1, ref_names = 2, ref_lengths = 3, query_index = 4 } Block_type;
 	uint64_t diamond_build, db_seqs, db_seqs_used, db_letters, flags, query_records;
 	int32_t mode, gap_open, gap_extend, reward, penalty, reserved1, reserved2, reserved3;
 	double k, lambda, evalue, reserved5;
@@ -127,6 +128,10 @@ struct DAA_file
 		}
 		ref_len_.resize((size_t)h2_.db_seqs_used);
 		f_.read(ref_len_.data(), (size_t)h2_.db_seqs_used);
+		if (h2_.block_type[3] == DAA_header2::query_index) {
+			query_offsets_.resize((size_t)h2_.block_size[3] / sizeof(uint64_t));
+			f_.read(query_offsets_.data(), query_offsets_.size());
+		}
 
 		f_.seek(sizeof(DAA_header1) + sizeof(DAA_header2));
 	}
@@ -215,6 +220,34 @@ struct DAA_file
 		return f_;
 	}
 
+	// The query index stores the offsets of the query records relative to the alignments block,
+	// followed by the offset of the block terminator.
+	bool has_query_index() const {
+		return !query_offsets_.empty();
+	}
+
+	size_t indexed_queries() const {
+		return query_offsets_.empty() ? 0 : query_offsets_.size() - 1;
+	}
+
+	// Claims up to n query records following the ones read so far, returns the number claimed.
+	size_t claim_queries(size_t n, size_t &begin)
+	{
+		begin = query_count_;
+		query_count_ = std::min(query_count_ + n, indexed_queries());
+		return query_count_ - begin;
+	}
+
+	// Reads the records of queries [begin, end) through a separate stream using the query index.
+	void read_query_range(StreamEntity &f, size_t begin, size_t end, BinaryBuffer &buf) const
+	{
+		const size_t size = size_t(query_offsets_[end] - query_offsets_[begin]);
+		buf.resize(size);
+		f.seek(int64_t(sizeof(DAA_header1) + sizeof(DAA_header2) + query_offsets_[begin]), SEEK_SET);
+		if (f.read(buf.data(), size) != size)
+			throw std::runtime_error("Unexpected end of DAA file.");
+	}
+
 private:
 
 	InputFile f_;
@@ -223,6 +256,7 @@ private:
 	DAA_header2 h2_;
 	PtrVector<std::string> ref_name_;
 	std::vector<uint32_t> ref_len_;
+	std::vector<uint64_t> query_offsets_;
 
 	friend void write_file(DAA_file&, OutputFile&);
 
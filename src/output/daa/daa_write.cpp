@@ -6,6 +6,52 @@
 using std::string;
 using std::vector;
 
+DAA_output_file::DAA_output_file(const string& file_name, Compressor compressor, int threads):
+	OutputFile(file_name, compressor, "wb", threads),
+	pos(0),
+	indexed_(compressor == Compressor::NONE),
+	record_left_(0),
+	size_bytes_(0)
+{}
+
+void DAA_output_file::consume(const char* ptr, size_t n)
+{
+	OutputFile::consume(ptr, n);
+	if (!indexed_)
+		return;
+	const char* end = ptr + n;
+	while (ptr < end) {
+		if (record_left_ > 0) {
+			const uint64_t k = std::min(record_left_, uint64_t(end - ptr));
+			record_left_ -= k;
+			ptr += k;
+			pos += k;
+			continue;
+		}
+		if (size_bytes_ == 0)
+			query_offsets.push_back(pos);
+		size_[size_bytes_++] = *ptr++;
+		++pos;
+		if (size_bytes_ == sizeof(size_)) {
+			uint32_t size;
+			memcpy(&size, size_, sizeof(size));
+			record_left_ = size;
+			size_bytes_ = 0;
+		}
+	}
+}
+
+static void write_query_index(OutputFile& f, DAA_header2& h2)
+{
+	DAA_output_file* out = dynamic_cast<DAA_output_file*>(&f);
+	if (out == nullptr || !out->index_complete())
+		return;
+	out->query_offsets.push_back(out->pos);
+	f.write(out->query_offsets.data(), out->query_offsets.size());
+	h2.block_type[3] = DAA_header2::query_index;
+	h2.block_size[3] = out->query_offsets.size() * sizeof(uint64_t);
+}
+
 void init_daa(OutputFile& f)
 {
 	DAA_header1 h1;
@@ -88,6 +134,7 @@ void finish_daa(OutputFile& f, const SequenceFile& db)
 	for (size_t i = 0; i < n; ++i)
 		f << (uint32_t)db.dict_len(i, 0);
 	h2_.block_size[2] = n * sizeof(uint32_t);
+	write_query_index(f, h2_);
 
 	f.seek(sizeof(DAA_header1));
 	f.write(&h2_, 1);
@@ -136,6 +183,7 @@ void finish_daa(OutputFile& f, DAA_file& daa_in) {
 
 	f.write(daa_in.ref_len().data(), daa_in.ref_len().size());
 	h2_.block_size[2] = daa_in.block_size(2);
+	write_query_index(f, h2_);
 
 	write_header2(f, h2_);
 }
@@ -153,5 +201,6 @@ void finish_daa(OutputFile& f, DAA_file& daa_in, const StringSet& seq_ids, const
 	h2_.block_size[1] = (uint64_t)s;
 	f.write(seq_lens.data(), seq_lens.size());
 	h2_.block_size[2] = seq_lens.size() * sizeof(uint32_t);
+	write_query_index(f, h2_);
 	write_header2(f, h2_);
 }
@@ -25,6 +25,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "daa_file.h"
 #include "../data/sequence_file.h"
 
+// DAA output file that keeps track of the offsets of the query records passed to consume(), so that
+// finish_daa can append them as the query index block.
+struct DAA_output_file : public OutputFile
+{
+	DAA_output_file(const std::string& file_name, Compressor compressor = Compressor::NONE, int threads = 1);
+	virtual void consume(const char* ptr, size_t n) override;
+	bool index_complete() const {
+		return indexed_ && record_left_ == 0 && size_bytes_ == 0;
+	}
+	std::vector<uint64_t> query_offsets;
+	uint64_t pos;
+private:
+	const bool indexed_;
+	uint64_t record_left_;
+	int size_bytes_;
+	char size_[4];
+};
+
 void init_daa(OutputFile& f);
 
 size_t write_daa_query_record(TextBuffer& buf, const char* query_name, const Sequence& query);
@@ -44,7 +44,7 @@ unordered_map<uint32_t, uint32_t> build_mapping(unordered_map<string, uint32_t>&
 	return r;
 }
 
-static int64_t write_file(DAA_file& f, OutputFile& out, const unordered_map<uint32_t, uint32_t>& subject_map) {
+static int64_t write_file(DAA_file& f, DAA_output_file& out, const unordered_map<uint32_t, uint32_t>& subject_map) {
 	uint32_t size = 0;
 	BinaryBuffer buf;
 	TextBuffer out_buf;
@@ -57,7 +57,7 @@ static int64_t write_file(DAA_file& f, OutputFile& out, const unordered_map<uint
 			copy_match_record_raw(it, out_buf, subject_map);
 		}
 		finish_daa_query_record(out_buf, seek_pos);
-		out.write(out_buf.data(), out_buf.size());
+		out.consume(out_buf.data(), out_buf.size());
 		out_buf.clear();
 	}
 	return int64_t(query_num + 1);
@@ -80,7 +80,7 @@ void merge_daa() {
 	}
 	message_stream << "Total number of targets: " << acc2oid.size() << endl;
 	timer.go("Initializing output");
-	OutputFile out(config.output_file);
+	DAA_output_file out(config.output_file);
 	init_daa(out);
 	int64_t query_count = 0;
 	for (vector<DAA_file*>::iterator i = files.begin(); i < files.end(); ++i) {
@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../data/taxonomy.h"
 #include "daa_write.h"
 #include "../run/config.h"
+#include "../util/io/file_source.h"
 
 using std::thread;
 using std::unique_ptr;
@@ -43,12 +44,12 @@ const unsigned view_buf_size = 32;
 
 struct View_writer
 {
-	View_writer() :
-		f_(new OutputFile(config.output_file, config.compressor()))
+	View_writer(bool daa) :
+		f_(daa ? new DAA_output_file(config.output_file, config.compressor(), config.threads_) : new OutputFile(config.output_file, config.compressor(), "wb", config.threads_))
 	{ }
 	void operator()(TextBuffer &buf)
 	{
-		f_->write(buf.data(), buf.size());
+		f_->consume(buf.data(), buf.size());
 		buf.clear();
 	}
 	~View_writer()
@@ -58,13 +59,25 @@ struct View_writer
 	unique_ptr<OutputFile> f_;
 };
 
+// With a query index, the fetcher only claims a range of queries while holding the queue lock and
+// the records are read by the worker through its own file handle.
 struct View_fetcher
 {
 	View_fetcher(DAA_file &daa) :
-		daa(daa)
+		daa(daa),
+		file(daa.has_query_index() ? new FileSource(daa.file().file_name) : nullptr)
 	{ }
+	~View_fetcher()
+	{
+		if (file)
+			file->close();
+	}
 	bool operator()()
 	{
+		if (file) {
+			n = (unsigned)daa.claim_queries(view_buf_size, query_num);
+			return query_num + n < daa.indexed_queries();
+		}
 		n = 0;
 		for (unsigned i = 0; i<view_buf_size; ++i)
 			if (!daa.read_query_buffer(buf[i], query_num)) {
@@ -76,10 +89,23 @@ struct View_fetcher
 		query_num -= n - 1;
 		return true;
 	}
-	BinaryBuffer buf[view_buf_size];
+	void load()
+	{
+		if (!file || n == 0)
+			return;
+		daa.read_query_range(*file, query_num, query_num + n, range);
+		BinaryBuffer::Iterator it = range.begin();
+		uint32_t size;
+		for (unsigned i = 0; i < n; ++i) {
+			it.read(size);
+			it.read(buf[i], size);
+		}
+	}
+	BinaryBuffer buf[view_buf_size], range;
 	unsigned n;
 	size_t query_num;
 	DAA_file &daa;
+	unique_ptr<FileSource> file;
 };
 
 void view_query(DAA_query_record &r, TextBuffer &out, OutputFormat &format, const Search::Config& cfg)
@@ -102,7 +128,7 @@ void view_query(DAA_query_record &r, TextBuffer &out, OutputFormat &format, cons
 		if (format == OutputFormat::daa)
 			write_daa_record(out, *i, i->subject_id);
 		else
-			f->print_match(i->context(), info);
+			f->print_match(i->context().parse(nullptr), info);
 	}
 	if (format == OutputFormat::daa)
 		finish_daa_query_record(out, seek_pos);
@@ -119,6 +145,7 @@ void view_worker(DAA_file *daa, View_writer *writer, TaskQueue<TextBuffer, View_
 		View_fetcher query_buf(*daa);
 		TextBuffer *buffer = 0;
 		while (queue->get(n, buffer, query_buf)) {
+			query_buf.load();
 			for (unsigned j = 0; j < query_buf.n; ++j) {
 				DAA_query_record r(*daa, query_buf.buf[j], query_buf.query_num + j);
 				view_query(r, *buffer, *format, *cfg);
@@ -149,11 +176,11 @@ void view_daa()
 	cfg.db_seqs = daa.db_seqs();
 	cfg.db_letters = daa.db_letters();
 
-	init_output(cfg.max_target_seqs);
+	cfg.output_format.reset(init_output(cfg.max_target_seqs));
 	taxonomy.init();
 
 	timer.go("Generating output");
-	View_writer writer;
+	View_writer writer(*cfg.output_format == OutputFormat::daa);
 	if (*cfg.output_format == OutputFormat::daa)
 		init_daa(*writer.f_);
 
@@ -32,6 +32,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/log_stream.h"
 #include "../align/global_ranking/global_ranking.h"
 #include "../legacy/util/task_queue.h"
+#include "../util/io/input_stream_buffer.h"
 
 using std::thread;
 using std::unique_ptr;
@@ -39,12 +40,15 @@ using std::set;
 using std::string;
 using std::vector;
 
+// Fetches the records of a range of consecutive queries from all block files. The ranges are
+// processed independently by the join workers, so only reading the raw records is serialized.
 struct JoinFetcher
 {
+	enum { QUERY_RANGE = 64 };
 	static void init(const PtrVector<TempFile> &tmp_file)
 	{
 		for (PtrVector<TempFile>::const_iterator i = tmp_file.begin(); i != tmp_file.end(); ++i) {
-			files.push_back(new InputFile(**i));
+			files.push_back(new InputFile(**i, InputStreamBuffer::ASYNC));
 			query_ids.push_back(0);
 			files.back().read(&query_ids.back(), 1);
 
@@ -55,7 +59,7 @@ struct JoinFetcher
 	static void init(const vector<string> & tmp_file_names)
 	{
 		for (auto file_name : tmp_file_names) {
-			files.push_back(new InputFile(file_name, InputFile::NO_AUTODETECT));
+			files.push_back(new InputFile(file_name, InputFile::NO_AUTODETECT | InputStreamBuffer::ASYNC));
 			query_ids.push_back(0);
 			files.back().read(&query_ids.back(), 1);
 		}
@@ -76,35 +80,50 @@ struct JoinFetcher
 	static size_t block_count() {
 		return files.size();
 	}
-	void fetch(unsigned b)
+	void fetch(unsigned b, uint32_t query_end)
 	{
 		uint32_t size;
-		files[b].read(&size, 1);
 		buf[b].clear();
-		buf[b].resize(size);
-		files[b].read(buf[b].data(), size);
-		files[b].read(&query_ids[b], 1);
+		while (query_ids[b] < query_end) {
+			files[b].read(&size, 1);
+			const size_t begin = buf[b].size();
+			buf[b].resize(begin + size);
+			files[b].read(buf[b].data() + begin, size);
+			records.push_back({ query_ids[b], b, begin, begin + size });
+			files[b].read(&query_ids[b], 1);
+		}
 	}
 	JoinFetcher(size_t blocks):
 		buf(blocks)
 	{}
 	bool operator()()
 	{
-		query_id = next();
+		query_begin = next();
 		unaligned_from = query_last + 1;
-		query_last = query_id;
-		for (unsigned i = 0; i < buf.size(); ++i)
-			if (query_ids[i] == query_id && query_id != IntermediateRecord::FINISHED)
-				fetch(i);
-			else
-				buf[i].clear();
+		records.clear();
+		if (query_begin != IntermediateRecord::FINISHED) {
+			const uint32_t query_end = (uint32_t)std::min((uint64_t)query_begin + QUERY_RANGE, (uint64_t)IntermediateRecord::FINISHED);
+			for (unsigned i = 0; i < buf.size(); ++i)
+				fetch(i, query_end);
+			query_last = query_begin;
+			for (const Record& r : records)
+				query_last = std::max(query_last, r.query_id);
+		}
 		return next() != IntermediateRecord::FINISHED;
 	}
+	struct Record {
+		uint32_t query_id, block;
+		size_t begin, end;
+		bool operator<(const Record& r) const {
+			return query_id < r.query_id || (query_id == r.query_id && block < r.block);
+		}
+	};
 	static PtrVector<InputFile> files;
 	static vector<uint32_t> query_ids;
 	static unsigned query_last;
 	vector<BinaryBuffer> buf;
-	uint32_t query_id, unaligned_from;
+	vector<Record> records;
+	uint32_t query_begin, unaligned_from;
 };
 
 PtrVector<InputFile> JoinFetcher::files;
@@ -167,47 +186,89 @@ struct JoinRecord
 
 };
 
+// Merges the records of the blocks with a loser tree. tree_[0] is the slot of the current winner,
+// tree_[1..k-1] hold the losers of the matches at the inner nodes.
 struct BlockJoiner
 {
-	BlockJoiner(vector<BinaryBuffer> &buf, const SequenceFile& db, const OutputFormat* output_format)
+	typedef vector<std::pair<int64_t, BinaryBuffer::Iterator>> Blocks;
+	BlockJoiner(const Blocks &blocks, const SequenceFile& db, const OutputFormat* output_format):
+		//pred_((config.toppercent == 100.0 && config.global_ranking_targets == 0) ? JoinRecord::cmp_evalue : JoinRecord::cmp_score)
+		pred_((config.toppercent == 100.0) ? JoinRecord::cmp_evalue : JoinRecord::cmp_score)
 	{
-		for (auto i = buf.begin(); i != buf.end(); ++i) {
-			it.push_back(i->begin());
-			JoinRecord::push_next(i - buf.begin(), std::numeric_limits<unsigned>::max(), it.back(), records, db, output_format);
+		for (auto i = blocks.begin(); i != blocks.end(); ++i) {
+			it.push_back(i->second);
+			if (!JoinRecord::push_next(i->first, std::numeric_limits<unsigned>::max(), it.back(), records, db, output_format))
+				it.pop_back();
 		}
-		//std::make_heap(records.begin(), records.end(), (config.toppercent == 100.0 && config.global_ranking_targets == 0) ? JoinRecord::cmp_evalue : JoinRecord::cmp_score);
-		std::make_heap(records.begin(), records.end(), (config.toppercent == 100.0) ? JoinRecord::cmp_evalue : JoinRecord::cmp_score);
+		active_.assign(records.size(), true);
+		build();
 	}
 	bool get(vector<IntermediateRecord> &target_hsp, int64_t& block_idx, OId& target_oid, const SequenceFile& db, const OutputFormat* output_format)
 	{
-		if (records.empty())
+		if (records.empty() || !active_[tree_[0]])
 			return false;
-		const JoinRecord &first = records.front();
+		const JoinRecord &first = records[tree_[0]];
 		const int64_t block = first.block_;
 		block_idx = block;
 		target_oid = first.info_.target_oid;
 		const DictId subject = first.info_.target_dict_id;
 		target_hsp.clear();
-		//const auto pred = (config.toppercent == 100.0 && config.global_ranking_targets == 0) ? JoinRecord::cmp_evalue : JoinRecord::cmp_score;
-		const auto pred = (config.toppercent == 100.0) ? JoinRecord::cmp_evalue : JoinRecord::cmp_score;
 		do {
-			const JoinRecord &next = records.front();
+			const int w = tree_[0];
+			JoinRecord &next = records[w];
 			if (next.block_ != block || next.info_.target_dict_id != subject)
 				return true;
 			target_hsp.push_back(next.info_);
-			std::pop_heap(records.begin(), records.end(), pred);
-			records.pop_back();
-			if (JoinRecord::push_next(block, subject, it[block], records, db, output_format))
-				std::push_heap(records.begin(), records.end(), pred);
-		} while (!records.empty());
+			if (it[w].good())
+				next = JoinRecord(block, subject, it[w], db, output_format);
+			else
+				active_[w] = false;
+			replay(w);
+		} while (active_[tree_[0]]);
 		return true;
 	}
 	vector<JoinRecord> records;
 	vector<BinaryBuffer::Iterator> it;
+private:
+	bool beats(int a, int b) const
+	{
+		if (!active_[a] || !active_[b])
+			return active_[a];
+		if (records[a].same_subject_ || records[b].same_subject_)
+			return records[a].same_subject_;
+		return pred_(records[b], records[a]);
+	}
+	void build()
+	{
+		const int k = (int)records.size();
+		vector<int> winner(2 * k);
+		tree_.assign(std::max(k, 1), 0);
+		for (int i = 0; i < k; ++i)
+			winner[k + i] = i;
+		for (int n = k - 1; n >= 1; --n) {
+			const int a = winner[2 * n], b = winner[2 * n + 1];
+			winner[n] = beats(b, a) ? b : a;
+			tree_[n] = beats(b, a) ? a : b;
+		}
+		if (k > 1)
+			tree_[0] = winner[1];
+	}
+	void replay(int slot)
+	{
+		const int k = (int)records.size();
+		int w = slot;
+		for (int n = (slot + k) >> 1; n >= 1; n >>= 1)
+			if (beats(tree_[n], w))
+				std::swap(tree_[n], w);
+		tree_[0] = w;
+	}
+	bool (*pred_)(const JoinRecord&, const JoinRecord&);
+	vector<int> tree_;
+	vector<bool> active_;
 };
 
 void join_query(
-	vector<BinaryBuffer> &buf,
+	const BlockJoiner::Blocks &blocks,
 	TextBuffer &out,
 	Statistics &statistics,
 	unsigned query,
@@ -219,7 +280,7 @@ void join_query(
 	TranslatedSequence query_seq(cfg.query->translated(query));
 	Output::Info info = { cfg.query->seq_info(query), false, cfg.db.get(), out, {} };
 	const double query_self_aln_score = flag_any(cfg.output_format->flags, Output::Flags::SELF_ALN_SCORES) ? cfg.query->self_aln_score(query) : 0.0;
-	BlockJoiner joiner(buf, *cfg.db, cfg.output_format.get());
+	BlockJoiner joiner(blocks, *cfg.db, cfg.output_format.get());
 	vector<IntermediateRecord> target_hsp;
 	unique_ptr<TargetCulling> culling(TargetCulling::get(cfg.max_target_seqs));
 
@@ -284,41 +345,55 @@ void join_worker(TaskQueue<TextBuffer, JoinWriter> *queue, const Search::Config*
 		const StringSet& qids = cfg->query->ids();
 		//BitVector ranking_db_filter(config.global_ranking_targets > 0 ? cfg->db_seqs : 0);
 
-		while (queue->get(n, out, fetcher) && fetcher.query_id != IntermediateRecord::FINISHED) {
-			//if (!config.global_ranking_targets) stat.inc(Statistics::ALIGNED);
-			stat.inc(Statistics::ALIGNED);
-			size_t seek_pos;
-
-			const char* query_name = qids[qids.check_idx(fetcher.query_id)];
-
-			const Sequence query_seq = align_mode.query_translated ? cfg->query->source_seqs()[fetcher.query_id] : cfg->query->seqs()[fetcher.query_id];
-
-			if (*cfg->output_format != OutputFormat::daa && config.report_unaligned != 0) {
-				for (unsigned i = fetcher.unaligned_from; i < fetcher.query_id; ++i) {
-					Output::Info info{ cfg->query->seq_info(i), true, cfg->db.get(), *out, {} };
-					cfg->output_format->print_query_intro(info);
-					cfg->output_format->print_query_epilog(info);
+		BlockJoiner::Blocks blocks;
+
+		while (queue->get(n, out, fetcher) && fetcher.query_begin != IntermediateRecord::FINISHED) {
+			std::sort(fetcher.records.begin(), fetcher.records.end());
+			uint32_t unaligned_from = fetcher.unaligned_from;
+			for (auto r = fetcher.records.cbegin(); r != fetcher.records.cend();) {
+				const uint32_t query_id = r->query_id;
+				blocks.clear();
+				for (; r != fetcher.records.cend() && r->query_id == query_id; ++r) {
+					const BinaryBuffer& buf = fetcher.buf[r->block];
+					blocks.emplace_back(r->block, BinaryBuffer::Iterator(buf.cbegin() + r->begin, buf.cbegin() + r->end));
 				}
-			}
 
-			unique_ptr<OutputFormat> f(cfg->output_format->clone());
+				//if (!config.global_ranking_targets) stat.inc(Statistics::ALIGNED);
+				stat.inc(Statistics::ALIGNED);
+				size_t seek_pos;
 
-			Output::Info info{ cfg->query->seq_info(fetcher.query_id), false, cfg->db.get(), *out, {} };
-			if (*f == OutputFormat::daa)
-				seek_pos = write_daa_query_record(*out, query_name, query_seq);
-			/*else if (config.global_ranking_targets)
-				seek_pos = Extension::GlobalRanking::write_merged_query_list_intro(fetcher.query_id, *out);*/
-			else
-				f->print_query_intro(info);
+				const char* query_name = qids[qids.check_idx(query_id)];
 
-			join_query(fetcher.buf, *out, stat, fetcher.query_id, query_name, (unsigned)query_seq.length(), *f, *cfg); // ranking_db_filter);
+				const Sequence query_seq = align_mode.query_translated ? cfg->query->source_seqs()[query_id] : cfg->query->seqs()[query_id];
 
-			if (*f == OutputFormat::daa)
-				finish_daa_query_record(*out, seek_pos);
-			/*else if (config.global_ranking_targets)
-				Extension::GlobalRanking::finish_merged_query_list(*out, seek_pos);*/
-			else
-				f->print_query_epilog(info);
+				if (*cfg->output_format != OutputFormat::daa && config.report_unaligned != 0) {
+					for (unsigned i = unaligned_from; i < query_id; ++i) {
+						Output::Info info{ cfg->query->seq_info(i), true, cfg->db.get(), *out, {} };
+						cfg->output_format->print_query_intro(info);
+						cfg->output_format->print_query_epilog(info);
+					}
+				}
+				unaligned_from = query_id + 1;
+
+				unique_ptr<OutputFormat> f(cfg->output_format->clone());
+
+				Output::Info info{ cfg->query->seq_info(query_id), false, cfg->db.get(), *out, {} };
+				if (*f == OutputFormat::daa)
+					seek_pos = write_daa_query_record(*out, query_name, query_seq);
+				/*else if (config.global_ranking_targets)
+					seek_pos = Extension::GlobalRanking::write_merged_query_list_intro(query_id, *out);*/
+				else
+					f->print_query_intro(info);
+
+				join_query(blocks, *out, stat, query_id, query_name, (unsigned)query_seq.length(), *f, *cfg); // ranking_db_filter);
+
+				if (*f == OutputFormat::daa)
+					finish_daa_query_record(*out, seek_pos);
+				/*else if (config.global_ranking_targets)
+					Extension::GlobalRanking::finish_merged_query_list(*out, seek_pos);*/
+				else
+					f->print_query_epilog(info);
+			}
 			queue->push(n);
 		}
 
@@ -337,7 +412,7 @@ void join_blocks(int64_t ref_blocks, Consumer &master_out, const PtrVector<TempF
 	const vector<string> tmp_file_names)
 {
 	if (*cfg.output_format != OutputFormat::daa)
-		cfg.db->init_random_access(cfg.current_query_block, config.multiprocessing ? tmp_file_names.size() : tmp_file.size());
+		cfg.db->init_random_access(cfg.current_query_block, tmp_file_names.empty() ? tmp_file.size() : tmp_file_names.size());
 	task_timer timer("Joining output blocks");
 
 	if (tmp_file_names.size() > 0) {
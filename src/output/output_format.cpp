@@ -215,8 +215,10 @@ OutputFormat* get_output_format()
 		return new Clustering_format(&f[1]);
 	else if (f[0] == "edge")
 		return new Output::Format::Edge;
+	else if (f[0] == "col")
+		return new Columnar_format;
 	else
-		throw std::runtime_error("Invalid output format: " + f[0] + "\nAllowed values: 0,5,xml,6,tab,100,daa,101,sam,102,103,paf");
+		throw std::runtime_error("Invalid output format: " + f[0] + "\nAllowed values: 0,5,xml,6,tab,100,daa,101,sam,102,103,paf,col");
 }
 
 OutputFormat* init_output(const int64_t max_target_seqs)
@@ -227,6 +229,8 @@ OutputFormat* init_output(const int64_t max_target_seqs)
 
 	if (*output_format == OutputFormat::daa && config.multiprocessing)
 		throw std::runtime_error("The DAA format is not supported in multiprocessing mode.");
+	if (*output_format == OutputFormat::columnar && (config.multiprocessing || (config.command != Config::blastp && config.command != Config::blastx)))
+		throw std::runtime_error("The columnar format is only supported for blastp/blastx without multiprocessing.");
 	if (*output_format == OutputFormat::daa && config.global_ranking_targets)
 		throw std::runtime_error("The DAA format is not supported in global ranking mode.");
 	if (*output_format == OutputFormat::taxon && config.toppercent == 100.0 && config.min_bit_score == 0.0)
@@ -35,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../run/config.h"
 #include "../dp/flags.h"
 #include "def.h"
+#include "columnar_writer.h"
 
 namespace Output {
 
@@ -82,7 +83,7 @@ struct OutputFormat
 	bool needs_taxon_id_lists, needs_taxon_nodes, needs_taxon_scientific_names, needs_taxon_ranks, needs_paired_end_info;
 	HspValues hsp_values;
 	Output::Flags flags;
-	enum { daa, blast_tab, blast_xml, sam, blast_pairwise, null, taxon, paf, bin1, EDGE };
+	enum { daa, blast_tab, blast_xml, sam, blast_pairwise, null, taxon, paf, bin1, EDGE, columnar };
 };
 
 struct Null_format : public OutputFormat
@@ -120,6 +121,7 @@ struct Blast_tab_format : public OutputFormat
 	virtual void print_header(Consumer &f, int mode, const char *matrix, int gap_open, int gap_extend, double evalue, const char *first_query_name, unsigned first_query_len) const override;
 	virtual void print_query_intro(Output::Info& info) const override;
 	virtual void print_match(const HspContext& r, Output::Info& info) override;
+	void print_field(int64_t field, const HspContext& r, Output::Info& info);
 	virtual ~Blast_tab_format()
 	{ }
 	virtual OutputFormat* clone() const override
@@ -131,6 +133,27 @@ struct Blast_tab_format : public OutputFormat
 	std::vector<int64_t> fields;
 };
 
+// Writes the fields of Blast_tab_format as typed binary rows which are assembled into column chunks
+// by ColumnarWriter. Numeric fields are written as int64/double, all other fields as strings.
+struct Columnar_format : public Blast_tab_format
+{
+	Columnar_format();
+	virtual void print_header(Consumer &f, int mode, const char *matrix, int gap_open, int gap_extend, double evalue, const char *first_query_name, unsigned first_query_len) const override
+	{}
+	virtual void print_query_intro(Output::Info& info) const override
+	{}
+	virtual void print_query_epilog(Output::Info& info) const override
+	{}
+	virtual void print_match(const HspContext& r, Output::Info& info) override;
+	virtual ~Columnar_format()
+	{ }
+	virtual OutputFormat* clone() const override
+	{
+		return new Columnar_format(*this);
+	}
+	std::vector<ColumnarWriter::Column> columns() const;
+};
+
 struct PAF_format : public OutputFormat
 {
 	PAF_format():
@@ -34,8 +34,7 @@ void Taxon_format::print_match(const HspContext &r, Output::Info &info)
 		return;
 	evalue = std::min(evalue, r.evalue());
 	try {
-		for (vector<TaxId>::const_iterator i = taxons.begin(); i != taxons.end(); ++i)
-			taxid = info.db->taxon_nodes().get_lca(taxid, *i);
+		taxid = info.db->taxon_nodes().get_lca(taxons, taxid);
 	}
 	catch (std::exception &) {
 		std::cerr << "Query=" << r.query_title << endl << "Subject=" << r.target_title << endl;
@@ -0,0 +1,134 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#ifdef WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+#include "checkpoint.h"
+#include "../basic/config.h"
+
+using std::string;
+using std::runtime_error;
+using std::endl;
+
+namespace Search {
+
+static const char* const MAGIC = "diamond_checkpoint";
+static const int VERSION = 1;
+
+// Identifies the run a checkpoint belongs to, resuming with different inputs or block size would corrupt the output.
+static string run_id() {
+	std::ostringstream s;
+	for (const string& q : config.query_file)
+		s << q << ';';
+	s << config.database.get("") << ';' << config.chunk_size << ';' << config.command;
+	return s.str();
+}
+
+Checkpoint::Checkpoint() :
+	query_block(0),
+	ref_blocks(0),
+	ref_offset(0),
+	out_size(0),
+	unaligned_size(0),
+	aligned_size(0)
+{}
+
+string Checkpoint::file_name() {
+	return config.output_file + ".ckpt";
+}
+
+bool Checkpoint::load() {
+	std::ifstream f(file_name());
+	if (!f.good())
+		return false;
+	string magic, id;
+	int version;
+	size_t n;
+	f >> magic >> version;
+	std::getline(f, id);
+	std::getline(f, id);
+	if (magic != MAGIC || version != VERSION)
+		throw runtime_error("Invalid checkpoint file: " + file_name());
+	if (id != run_id())
+		throw runtime_error("Checkpoint file " + file_name() + " belongs to a run with different input files or block size.");
+	f >> query_block >> ref_blocks >> ref_offset >> out_size >> unaligned_size >> aligned_size >> n;
+	stats.resize(n);
+	for (stat_type& x : stats)
+		f >> x;
+	if (!f.good())
+		throw runtime_error("Error reading checkpoint file: " + file_name());
+	return true;
+}
+
+void Checkpoint::save() {
+	stats.assign(statistics.data_, statistics.data_ + Statistics::COUNT);
+	const string tmp = file_name() + ".tmp";
+	{
+		std::ofstream f(tmp);
+		f << MAGIC << ' ' << VERSION << endl << run_id() << endl;
+		f << query_block << ' ' << ref_blocks << ' ' << ref_offset << ' ' << out_size << ' ' << unaligned_size << ' ' << aligned_size << endl;
+		f << stats.size();
+		for (stat_type x : stats)
+			f << ' ' << x;
+		f << endl;
+		f.flush();
+		if (!f.good())
+			throw runtime_error("Error writing checkpoint file: " + tmp);
+	}
+#ifdef WIN32
+	std::remove(file_name().c_str());
+#endif
+	if (std::rename(tmp.c_str(), file_name().c_str()) != 0)
+		throw runtime_error("Error writing checkpoint file: " + file_name());
+}
+
+void Checkpoint::remove() const {
+	std::remove(file_name().c_str());
+}
+
+void Checkpoint::restore_statistics() const {
+	statistics.reset();
+	std::copy(stats.begin(), stats.begin() + std::min(stats.size(), (size_t)Statistics::COUNT), statistics.data_);
+}
+
+void truncate_file(const string& file_name, int64_t size) {
+#ifdef WIN32
+	const int fd = _open(file_name.c_str(), _O_RDWR | _O_BINARY);
+	const bool ok = fd >= 0 && _chsize_s(fd, size) == 0;
+	if (fd >= 0)
+		_close(fd);
+	if (!ok)
+#else
+	if (::truncate(file_name.c_str(), (off_t)size) != 0)
+#endif
+		throw runtime_error("Error truncating file: " + file_name);
+}
+
+}
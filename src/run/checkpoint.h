@@ -0,0 +1,52 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "../basic/statistics.h"
+
+namespace Search {
+
+// Progress of a search run with --checkpoint, stored in <output file>.ckpt. Query block query_block was
+// started with the output files at the recorded sizes, and its first ref_blocks reference blocks are
+// complete. Their outputs and dictionaries are kept in parallel_tmpdir, and the next reference block starts
+// at database position ref_offset.
+struct Checkpoint {
+
+	Checkpoint();
+	// Returns false if no checkpoint exists.
+	bool load();
+	// Atomically replaces the checkpoint file, recording the current global statistics.
+	void save();
+	void remove() const;
+	void restore_statistics() const;
+	static std::string file_name();
+
+	int64_t query_block, ref_blocks, ref_offset, out_size, unaligned_size, aligned_size;
+	std::vector<stat_type> stats;
+
+};
+
+void truncate_file(const std::string& file_name, int64_t size);
+
+}
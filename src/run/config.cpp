@@ -12,6 +12,7 @@
 #include "../masking/masking.h"
 #include "../align/def.h"
 #include "../dna/dna_index.h"
+#include "checkpoint.h"
 
 
 using std::endl;
@@ -75,6 +76,21 @@ Config::Config() :
 			throw std::runtime_error("Global ranking mode is not compatible with --multiprocessing.");
 	}
 
+	if (config.checkpoint) {
+		if (config.multiprocessing)
+			throw std::runtime_error("--checkpoint is not compatible with --multiprocessing, use --mp-recover instead.");
+		if (sensitivity.size() > 1)
+			throw std::runtime_error("Iterated search is not compatible with --checkpoint.");
+		if (config.global_ranking_targets)
+			throw std::runtime_error("Global ranking mode is not compatible with --checkpoint.");
+		if (config.self)
+			throw std::runtime_error("--checkpoint is not compatible with self alignment.");
+		if (config.output_file.empty())
+			throw std::runtime_error("--checkpoint requires an output file (--out/-o).");
+		if (!config.unaligned_targets.empty())
+			throw std::runtime_error("--unaligned-targets is not compatible with --checkpoint.");
+	}
+
 	if (config.target_indexed && config.algo != ::Config::Algo::AUTO && config.algo != ::Config::Algo::DOUBLE_INDEXED)
 		throw std::runtime_error("--target-indexed requires --algo 0");
 
@@ -53,6 +53,7 @@ namespace Dna{
 namespace Search {
 
 struct Hit;
+struct Checkpoint;
 
 struct Config {
 
@@ -117,6 +118,7 @@ struct Config {
 	BlockId                                    iteration_query_aligned;
 
 	std::unique_ptr<ThreadPool>                thread_pool;
+	std::unique_ptr<Checkpoint>                checkpoint;
 
 	bool iterated() const {
 		return sensitivity.size() > 1;
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <memory>
 #include <algorithm>
 #include <cstdio>
+#include <set>
 #include "../data/reference.h"
 #include "../data/queries.h"
 #include "../basic/statistics.h"
@@ -53,6 +54,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../align/align.h"
 #include "../util/async_buffer.h"
 #include "config.h"
+#include "checkpoint.h"
 #include "../data/seed_array.h"
 #ifdef WITH_DNA
 #include "../dna/dna_index.h"
@@ -74,6 +76,7 @@ static const string label_align = "align";
 static const string stack_align_todo = label_align + "_todo";
 static const string stack_align_wip = label_align + "_wip";
 static const string stack_align_done = label_align + "_done";
+static const string stack_align_split = label_align + "_split";
 
 static const string label_join = "join";
 static const string stack_join_todo = label_join + "_todo";
@@ -97,6 +100,68 @@ static string get_ref_block_tmpfile_name(size_t query, size_t block) {
 	return join_path(config.parallel_tmpdir, file_name);
 }
 
+static string chunk_annotation(const string& line) {
+	size_t pos = 0;
+	for (int i = 0; i < 3 && pos != string::npos; ++i)
+		pos = line.find(' ', pos + (i > 0 ? 1 : 0));
+	return pos == string::npos ? string() : line.substr(pos);
+}
+
+// Splits off the second half of a chunk and puts it on the todo stack so that idle workers can take it over.
+// The split stack records "parent offset n_seqs" for every split, the id of the new chunk is the number of
+// partition chunks plus its line index in the split stack. Returns the remaining first half.
+static Chunk split_chunk(const Chunk& chunk, const string& line, WorkStack& splits, WorkStack& todo, int n_chunks) {
+	const int64_t n = chunk.n_seqs / 2;
+	Chunk tail(chunk.i, chunk.offset + n, chunk.n_seqs - n);
+	size_t split_count = 0;
+	splits.push(to_string(tail), split_count);
+	tail.i = n_chunks + (int)split_count - 1;
+	todo.push(to_string(tail) + chunk_annotation(line));
+	return Chunk(chunk.i, chunk.offset, n);
+}
+
+// Restores the chunks of a query block that were in progress. Chunks that were split are trimmed to their
+// first half, split chunks that never reached the todo stack are added to it.
+static void recover_align_chunks(size_t query_block, int n_chunks) {
+	auto P = Parallelizer::get();
+	auto todo = P->open_stack(get_ref_part_file_name(stack_align_todo, query_block));
+	auto wip = P->open_stack(get_ref_part_file_name(stack_align_wip, query_block));
+	const vector<string> split_lines = P->open_stack(get_ref_part_file_name(stack_align_split, query_block))->lines();
+	vector<Chunk> splits;
+	for (const string& l : split_lines)
+		splits.push_back(to_chunk(l));
+	string buf;
+	int j = 0;
+	while (wip->pop(buf)) {
+		Chunk chunk = to_chunk(buf);
+		for (const Chunk& s : splits)
+			if (s.i == chunk.i && s.offset > chunk.offset)
+				chunk.n_seqs = std::min(chunk.n_seqs, (int64_t)(s.offset - chunk.offset));
+		todo->push(to_string(chunk) + chunk_annotation(buf));
+		j++;
+	}
+	if (j > 0)
+		message_stream << "Restored " << j << " align chunks for query " << query_block << endl;
+
+	std::set<int> known;
+	for (const string& f : { stack_align_todo, stack_align_done })
+		for (const string& l : P->open_stack(get_ref_part_file_name(f, query_block))->lines())
+			known.insert(to_chunk(l).i);
+	for (size_t i = 0; i < splits.size(); ++i) {
+		const Chunk tail(n_chunks + (int)i, splits[i].offset, splits[i].n_seqs);
+		if (known.find(tail.i) == known.end()) {
+			todo->push(to_string(tail));
+			message_stream << "Restored split align chunk " << tail.i << " for query " << query_block << endl;
+		}
+	}
+}
+
+// If the output is compressed, the temporary output of the reference blocks is compressed in parallel as well.
+static Compressor tmp_file_compressor() {
+	const Compressor c = config.compressor();
+	return c == Compressor::ZLIB ? Compressor::BGZF : c;
+}
+
 static void run_ref_chunk(SequenceFile &db_file,
 	const unsigned query_iteration,
 	Consumer &master_out,
@@ -135,7 +200,7 @@ static void run_ref_chunk(SequenceFile &db_file,
 	const bool persist_dict = daa || cfg.iterated();
 	if(((cfg.blocked_processing || daa) && !config.global_ranking_targets) || cfg.iterated()) {
 		timer.go("Initializing dictionary");
-		if (config.multiprocessing || (cfg.current_ref_block == 0 && (!daa || cfg.current_query_block == 0) && query_iteration == 0))
+		if (config.persistent_ref_blocks() || (cfg.current_ref_block == 0 && (!daa || cfg.current_query_block == 0) && query_iteration == 0))
 			db_file.init_dict(cfg.current_query_block, cfg.current_ref_block);
 		if(!config.global_ranking_targets)
 			db_file.init_dict_block(cfg.current_ref_block, cfg.target->seqs().size(), persist_dict);
@@ -198,11 +263,11 @@ static void run_ref_chunk(SequenceFile &db_file,
 	const bool temp_output = (cfg.blocked_processing || cfg.iterated()) && !config.global_ranking_targets;
 	if (temp_output) {
 		timer.go("Opening temporary output file");
-		if (config.multiprocessing) {
+		if (config.persistent_ref_blocks()) {
 			const string file_name = get_ref_block_tmpfile_name(cfg.current_query_block, cfg.current_ref_block);
 			tmp_file.push_back(new TempFile(file_name));
 		} else {
-			tmp_file.push_back(new TempFile());
+			tmp_file.push_back(new TempFile(true, tmp_file_compressor(), config.threads_));
 		}
 		out = &tmp_file.back();
 	}
@@ -318,17 +383,24 @@ static void run_query_iteration(const unsigned query_iteration,
 		auto done = P->get_stack(stack_align_done);
 		P->create_stack_from_file(stack_join_todo, get_ref_part_file_name(stack_join_todo, options.current_query_block));
 		auto join_work = P->get_stack(stack_join_todo);
+		P->create_stack_from_file(stack_align_split, get_ref_part_file_name(stack_align_split, options.current_query_block));
+		auto splits = P->get_stack(stack_align_split);
+		const int n_chunks = db_file.get_n_partition_chunks();
 
 		string buf;
+		size_t todo_size = 0;
 
-		while ((!file_exists("stop")) && (work->pop(buf))) {
+		while ((!file_exists("stop")) && (work->pop(buf, todo_size))) {
 			wip->push(buf);
 
 			Chunk chunk = to_chunk(buf);
+			if (todo_size == 0 && config.mp_split_min_seqs > 0 && !config.mp_self && chunk.n_seqs >= 2 * config.mp_split_min_seqs)
+				chunk = split_chunk(chunk, buf, *splits, *work, n_chunks);
 
 			P->log("SEARCH BEGIN " + std::to_string(options.current_query_block) + " " + std::to_string(chunk.i));
 
-			options.target.reset(db_file.load_seqs((size_t)(0), options.db_filter.get(), load_flags, chunk));
+			options.target.reset(config.shared_db ? db_file.load_seqs_shared((size_t)(0), options.db_filter.get(), load_flags, chunk)
+				: db_file.load_seqs((size_t)(0), options.db_filter.get(), load_flags, chunk));
 			options.current_ref_block = chunk.i;
 			options.blocked_processing = true;
 			if (!config.mp_self || chunk.i >= options.current_query_block)
@@ -345,7 +417,7 @@ static void run_query_iteration(const unsigned query_iteration,
 
 			size_t size_after_push = 0;
 			done->push(buf, size_after_push);
-			if (size_after_push == (size_t)db_file.get_n_partition_chunks()) {
+			if (size_after_push == (size_t)n_chunks + splits->size()) {
 				join_work->push("TOKEN");
 			}
 			wip->remove(buf);
@@ -358,6 +430,7 @@ static void run_query_iteration(const unsigned query_iteration,
 		P->delete_stack(stack_align_todo);
 		P->delete_stack(stack_align_wip);
 		P->delete_stack(stack_align_done);
+		P->delete_stack(stack_align_split);
 	}
 	else {
 		/*if (config.self && !config.lin_stage1 && !db_file.eof())
@@ -365,7 +438,16 @@ static void run_query_iteration(const unsigned query_iteration,
 		else if (!config.self || options.current_query_block != 0 || !db_file.eof())
 			db_file.set_seqinfo_ptr(0);*/
 		db_file.set_seqinfo_ptr((config.self && !config.lin_stage1) ? options.query->oid_end() : 0);
-		for (options.current_ref_block = 0; ; ++options.current_ref_block) {
+		Checkpoint* checkpoint = options.checkpoint.get();
+		int first_ref_block = 0;
+		// Queries aligned in earlier reference blocks are not recorded, so --un/--al restart the query block.
+		if (checkpoint && checkpoint->query_block == options.current_query_block && checkpoint->ref_blocks > 0 && !options.track_aligned_queries) {
+			first_ref_block = (int)checkpoint->ref_blocks;
+			db_file.set_seqinfo_ptr(checkpoint->ref_offset);
+			options.blocked_processing = true;
+			message_stream << "Resuming query block " << options.current_query_block << " at reference block " << first_ref_block << endl;
+		}
+		for (options.current_ref_block = first_ref_block; ; ++options.current_ref_block) {
 			if (config.self && ((config.lin_stage1 && options.current_ref_block == options.current_query_block) || (!config.lin_stage1 && options.current_ref_block == 0))) {
 				options.target = options.query;
 				if (config.lin_stage1)
@@ -373,7 +455,8 @@ static void run_query_iteration(const unsigned query_iteration,
 			}
 			else {
 				timer.go("Loading reference sequences");
-				options.target.reset(db_file.load_seqs(config.block_size(), options.db_filter.get(), load_flags));
+				options.target.reset(config.shared_db ? db_file.load_seqs_shared(config.block_size(), options.db_filter.get(), load_flags)
+					: db_file.load_seqs(config.block_size(), options.db_filter.get(), load_flags));
 			}
 			if (options.current_ref_block == 0) {
 				db_file.reopen();
@@ -383,6 +466,14 @@ static void run_query_iteration(const unsigned query_iteration,
 			if (options.target->empty()) break;
 			timer.finish();
 			run_ref_chunk(db_file, query_iteration, master_out, tmp_file, options);
+			if (checkpoint && options.blocked_processing) {
+				tmp_file.back().close();
+				if (!options.track_aligned_queries) {
+					checkpoint->ref_blocks = options.current_ref_block + 1;
+					checkpoint->ref_offset = db_file.tell_seq();
+					checkpoint->save();
+				}
+			}
 		}
 		log_rss();
 	}
@@ -396,7 +487,7 @@ static void run_query_iteration(const unsigned query_iteration,
 		timer.go("Computing alignments");
 		Consumer* out;
 		if (options.iterated()) {
-			tmp_file.push_back(new TempFile());
+			tmp_file.push_back(new TempFile(true, tmp_file_compressor(), config.threads_));
 			out = &tmp_file.back();
 		}
 		else {
@@ -407,6 +498,27 @@ static void run_query_iteration(const unsigned query_iteration,
 	}
 }
 
+static int64_t flushed_size(Consumer* f) {
+	OutputFile* out = dynamic_cast<OutputFile*>(f);
+	if (!out)
+		return 0;
+	const int64_t size = out->tell();
+	fflush(out->file());
+	return size;
+}
+
+// Records that query blocks before query_block are complete and their output is written up to the current file sizes.
+static void save_checkpoint(Config& options, OutputFile* unaligned_file, OutputFile* aligned_file, int query_block) {
+	Checkpoint& checkpoint = *options.checkpoint;
+	checkpoint.query_block = query_block;
+	checkpoint.ref_blocks = 0;
+	checkpoint.ref_offset = 0;
+	checkpoint.out_size = flushed_size(options.out.get());
+	checkpoint.unaligned_size = flushed_size(unaligned_file);
+	checkpoint.aligned_size = flushed_size(aligned_file);
+	checkpoint.save();
+}
+
 static void run_query_chunk(Consumer &master_out,
 	OutputFile *unaligned_file,
 	OutputFile *aligned_file,
@@ -418,6 +530,7 @@ static void run_query_chunk(Consumer &master_out,
 	auto& query_seqs = options.query->seqs();
 
 	PtrVector<TempFile> tmp_file;
+	vector<string> tmp_file_names;
 	if (options.track_aligned_queries) {
 		query_aligned.clear();
 		query_aligned.insert(query_aligned.end(), options.query->source_seq_count(), false);
@@ -465,15 +578,16 @@ static void run_query_chunk(Consumer &master_out,
 				wip->push(buf);
 				work->clear();
 
-				options.current_ref_block = db_file.get_n_partition_chunks();
+				P->create_stack_from_file(stack_align_split, get_ref_part_file_name(stack_align_split, options.current_query_block));
+				options.current_ref_block = db_file.get_n_partition_chunks() + P->get_stack(stack_align_split)->size();
+				P->delete_stack(stack_align_split);
 
-				vector<string> tmp_file_names;
 				for (int64_t i=0; i<options.current_ref_block; ++i) {
 					tmp_file_names.push_back(get_ref_block_tmpfile_name(options.current_query_block, i));
 				}
 
 				const string query_chunk_output_file = append_label(config.output_file + "_", options.current_query_block);
-				Consumer *query_chunk_out(new OutputFile(query_chunk_output_file, config.compressor()));
+				Consumer *query_chunk_out(new OutputFile(query_chunk_output_file, config.compressor(), "wb", config.threads_));
 				// if (*output_format != Output_format::daa)
 				// 	output_format->print_header(*query_chunk_out, align_mode.mode, config.matrix.c_str(), score_matrix.gap_open(), score_matrix.gap_extend(), config.max_evalue, query_ids::get()[0],
 				// 		unsigned(align_mode.query_translated ? query_source_seqs::get()[0].length() : query_seqs::get()[0].length()));
@@ -501,6 +615,13 @@ static void run_query_chunk(Consumer &master_out,
 				P->log("JOIN END "+std::to_string(options.current_query_block));
 			}
 			P->delete_stack(stack_join_todo);
+		} else if (options.checkpoint) {
+			if (options.blocked_processing) {
+				for (int i = 0; i < options.current_ref_block; ++i)
+					tmp_file_names.push_back(get_ref_block_tmpfile_name(options.current_query_block, i));
+				tmp_file.clear();
+				join_blocks(options.current_ref_block, master_out, tmp_file, options, db_file, tmp_file_names);
+			}
 		} else {
 			if (!tmp_file.empty())
 				join_blocks(options.current_ref_block, master_out, tmp_file, options, db_file);
@@ -516,42 +637,49 @@ static void run_query_chunk(Consumer &master_out,
 		write_aligned(*options.query, aligned_file);
 	}
 
+	if (options.checkpoint) {
+		timer.go("Writing checkpoint");
+		save_checkpoint(options, unaligned_file, aligned_file, options.current_query_block + 1);
+		for (const string& f : tmp_file_names)
+			std::remove(f.c_str());
+	}
+
 	timer.go("Deallocating queries");
 	options.query.reset();
 }
 
+static unique_ptr<OutputFile> open_checkpointed(const string& file_name, int64_t size) {
+	truncate_file(file_name, size);
+	unique_ptr<OutputFile> f(new OutputFile(file_name, Compressor::NONE, "r+b"));
+	f->seek(0, SEEK_END);
+	return f;
+}
+
 static void master_thread(task_timer &total_timer, Config &options)
 {
 	log_rss();
 	SequenceFile* db_file = options.db.get();
+	auto P = Parallelizer::get();
+	if (config.multiprocessing)
+		P->set_coordinator(config.mp_coordinator);
 	if (config.multiprocessing && config.mp_recover) {
+		db_file->create_partition_balanced((size_t)(config.chunk_size*1e9));
 		const size_t max_assumed_query_chunks = 65536;
 		for (size_t i=0; i<max_assumed_query_chunks; ++i) {
 			const string file_align_todo = get_ref_part_file_name(stack_align_todo, i);
 			if (! file_exists(file_align_todo)) {
 				break;
-			} else {
-				auto stack_todo = FileStack(file_align_todo);
-				const string file_align_wip = get_ref_part_file_name(stack_align_wip, i);
-				auto stack_wip = FileStack(file_align_wip);
-				string buf;
-				int j = 0;
-				while (stack_wip.pop_non_locked(buf)) {
-					stack_todo.push_non_locked(buf);
-					j++;
-				}
-				if (j > 0)
-					message_stream << "Restored " << j << " align chunks for query " << i << endl;
-			}
+			} else
+				recover_align_chunks(i, db_file->get_n_partition_chunks());
 			const string file_join_wip = get_ref_part_file_name(stack_join_wip, i);
-			auto stack_wip = FileStack(file_join_wip);
-			if (stack_wip.size() > 0) {
+			auto stack_wip = P->open_stack(file_join_wip);
+			if (stack_wip->size() > 0) {
 				const string file_join_todo = get_ref_part_file_name(stack_join_todo, i);
-				auto stack_todo = FileStack(file_join_todo);
+				auto stack_todo = P->open_stack(file_join_todo);
 				string buf;
 				int j = 0;
-				while (stack_wip.pop_non_locked(buf)) {
-					stack_todo.push_non_locked(buf);
+				while (stack_wip->pop(buf)) {
+					stack_todo->push(buf);
 					j++;
 				}
 				if (j > 0)
@@ -565,7 +693,6 @@ static void master_thread(task_timer &total_timer, Config &options)
 		return;
 	}
 
-	auto P = Parallelizer::get();
 	if (config.multiprocessing) {
 		P->init(config.parallel_tmpdir);
 		db_file->create_partition_balanced((size_t)(config.chunk_size*1e9));
@@ -614,16 +741,42 @@ static void master_thread(task_timer &total_timer, Config &options)
 		return;
 	}
 
+	bool resume = false;
+	if (config.checkpoint) {
+		if (options.out)
+			throw std::runtime_error("--checkpoint is not supported for this output target.");
+		if (*options.output_format == OutputFormat::daa || *options.output_format == OutputFormat::columnar || config.compressor() != Compressor::NONE)
+			throw std::runtime_error("--checkpoint requires an uncompressed text output format.");
+		options.checkpoint.reset(new Checkpoint());
+		if (!config.resume.empty()) {
+			resume = options.checkpoint->load();
+			if (resume)
+				message_stream << "Resuming run from checkpoint at query block " << options.checkpoint->query_block << endl;
+			else
+				message_stream << "No checkpoint found, starting a new run." << endl;
+		}
+	}
+
 	timer.go("Opening the output file");
-	if (!options.out)
-		options.out.reset(new OutputFile(config.output_file, config.compressor()));
+	if (resume) {
+		options.out = open_checkpointed(config.output_file, options.checkpoint->out_size);
+		options.checkpoint->restore_statistics();
+	}
+	if (!options.out) {
+		if (*options.output_format == OutputFormat::daa)
+			options.out.reset(new DAA_output_file(config.output_file, config.compressor(), config.threads_));
+		else if (*options.output_format == OutputFormat::columnar)
+			options.out.reset(new ColumnarWriter(config.output_file, static_cast<const Columnar_format&>(*options.output_format).columns()));
+		else
+			options.out.reset(new OutputFile(config.output_file, config.compressor(), "wb", config.threads_));
+	}
 	if (*options.output_format == OutputFormat::daa)
 		init_daa(*static_cast<OutputFile*>(options.out.get()));
 	unique_ptr<OutputFile> unaligned_file, aligned_file;
 	if (!config.unaligned.empty())
-		unaligned_file = unique_ptr<OutputFile>(new OutputFile(config.unaligned));
+		unaligned_file = resume ? open_checkpointed(config.unaligned, options.checkpoint->unaligned_size) : unique_ptr<OutputFile>(new OutputFile(config.unaligned));
 	if (!config.aligned_file.empty())
-		aligned_file = unique_ptr<OutputFile>(new OutputFile(config.aligned_file));
+		aligned_file = resume ? open_checkpointed(config.aligned_file, options.checkpoint->aligned_size) : unique_ptr<OutputFile>(new OutputFile(config.aligned_file));
 	timer.finish();
 
 	for (;query_file_offset < db_file->sequence_count(); ++options.current_query_block) {
@@ -644,6 +797,8 @@ static void master_thread(task_timer &total_timer, Config &options)
 		options.query->seqs().print_stats();
 		if ((config.mp_query_chunk >= 0) && (options.current_query_block != config.mp_query_chunk))
 			continue;
+		if (resume && options.current_query_block < options.checkpoint->query_block)
+			continue;
 
 #ifndef KEEP_TARGET_ID
 		if (config.lin_stage1 && !config.kmer_ranking) {
@@ -653,10 +808,13 @@ static void master_thread(task_timer &total_timer, Config &options)
 		}
 #endif
 
-		if (options.current_query_block == 0 && *options.output_format != OutputFormat::daa && options.query->has_ids())
+		if (options.current_query_block == 0 && !resume && *options.output_format != OutputFormat::daa && options.query->has_ids())
 			options.output_format->print_header(*options.out, align_mode.mode, config.matrix.c_str(), score_matrix.gap_open(), score_matrix.gap_extend(), config.max_evalue, options.query->ids()[0],
 				unsigned(align_mode.query_translated ? options.query->source_seqs()[0].length() : options.query->seqs()[0].length()));
 
+		if (options.checkpoint && !(resume && options.current_query_block == options.checkpoint->query_block))
+			save_checkpoint(options, unaligned_file.get(), aligned_file.get(), options.current_query_block);
+
 		if (options.query_masking != MaskingAlgo::NONE) {
 			timer.go("Masking queries");
 			mask_seqs(options.query->seqs(), Masking::get(), true, options.query_masking);
@@ -690,6 +848,9 @@ static void master_thread(task_timer &total_timer, Config &options)
 	if (aligned_file.get())
 		aligned_file->close();
 
+	if (options.checkpoint && !file_exists("stop"))
+		options.checkpoint->remove();
+
 	if (!config.unaligned_targets.empty()) {
 		timer.go("Writing unaligned targets");
 		options.db->write_accession_list(options.aligned_targets, config.unaligned_targets);
@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/simd.h"
 #include "../data/dmnd/dmnd.h"
 #include "../util/command_line_parser.h"
+#include "../util/parallel/coordinator.h"
 
 using std::cout;
 using std::cerr;
@@ -83,6 +84,7 @@ namespace Cluster {
 void reassign();
 void realign();
 void recluster();
+void compute_medoids();
 namespace Incremental {
 }}
 
@@ -153,7 +155,9 @@ int main(int ac, const char* av[])
                 throw e;
             }
         }
-        Workflow::Cluster::ClusterRegistry::get(config.cluster_algo.get("cascaded"))->run();
+        if (!config.cluster_update.empty() && config.cluster_algo.get("incremental") != "incremental")
+            throw std::runtime_error("--update requires the incremental clustering algorithm.");
+        Workflow::Cluster::ClusterRegistry::get(config.cluster_algo.get(config.cluster_update.empty() ? "cascaded" : "incremental"))->run();
         break;
     case Config::translate:
         translate();
@@ -215,6 +219,14 @@ int main(int ac, const char* av[])
     case Config::RECLUSTER:
         Cluster::recluster();
         break;
+    case Config::compute_medoids:
+        Cluster::compute_medoids();
+        break;
+    case Config::MP_COORDINATOR:
+        if (config.mp_coordinator.empty())
+            throw std::runtime_error("Missing parameter: coordinator address (--mp-coordinator)");
+        run_coordinator(config.mp_coordinator);
+        break;
 #ifdef EXTRA
     case Config::INDEX_FASTA:
         index_fasta();
@@ -0,0 +1,171 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include "seed_index_cache.h"
+#include "../basic/config.h"
+#include "../basic/shape_config.h"
+#include "../data/block/block.h"
+#include "../data/sequence_file.h"
+#include "../run/config.h"
+
+using std::vector;
+using std::string;
+using std::atomic;
+using std::thread;
+using std::endl;
+
+namespace Search {
+
+std::unique_ptr<SeedIndexCache> seed_index_cache;
+
+SeedIndexCache::SeedIndexCache(size_t max_size, const std::set<std::string>& reused) :
+	reused_(reused),
+	db_(nullptr),
+	db_seqs_(0),
+	filter_(nullptr),
+	size_(0),
+	pending_size_(0),
+	max_size_(max_size)
+{}
+
+string SeedIndexCache::shape_id(const ::Shape& shape, int minimizer_window) {
+	return std::to_string(shape.length_) + ':' + std::to_string(shape.mask_) + ':' + std::to_string(minimizer_window);
+}
+
+string SeedIndexCache::key(unsigned sid, const Config& cfg) const {
+	std::ostringstream s;
+	const ::Shape& shape = shapes[sid];
+	s << shape.length_ << ':' << shape.mask_ << ':';
+	for (Letter l = 0; l < TRUE_AA; ++l)
+		s << Reduction::reduction(l) << ',';
+	s << (int)cfg.seed_encoding << ':' << (int)cfg.target_masking << ':' << cfg.lazy_masking << ':' << (int)cfg.soft_masking << ':' << cfg.seed_complexity_cut << ':' << cfg.minimizer_window;
+	return s.str();
+}
+
+void SeedIndexCache::begin_search(const SequenceFile* db, const BitVector* filter) {
+	if (db != db_ || db->sequence_count() != db_seqs_) {
+		shapes_.clear();
+		size_ = 0;
+	}
+	db_ = db;
+	db_seqs_ = db->sequence_count();
+	filter_ = filter;
+	pending_.clear();
+	pending_size_ = 0;
+}
+
+void SeedIndexCache::end_search() {
+	for (auto& p : pending_) {
+		if (!p.second.valid || shapes_.find(p.first) != shapes_.end())
+			continue;
+		if (filter_)
+			p.second.filter.reset(new BitVector(*filter_));
+		size_ += p.second.size;
+		shapes_.emplace(p.first, std::move(p.second));
+	}
+	pending_.clear();
+	pending_size_ = 0;
+	log_stream << "Seed index cache: " << shapes_.size() << " shapes, " << size_ << " bytes" << endl;
+}
+
+void SeedIndexCache::invalidate(unsigned sid, const Config& cfg) {
+	Shape& s = pending_[key(sid, cfg)];
+	s.valid = false;
+	pending_size_ -= s.size;
+	s.size = 0;
+	for (auto& v : s.entries)
+		vector<Entry>().swap(v);
+}
+
+void SeedIndexCache::put(unsigned sid, const Block& block, const SeedArray& seeds, const SeedPartitionRange& range, const Config& cfg) {
+	const string k = key(sid, cfg);
+	if (shapes_.find(k) != shapes_.end() || reused_.find(shape_id(shapes[sid], cfg.minimizer_window)) == reused_.end())
+		return;
+	const size_t n = seeds.size() * sizeof(Entry);
+	Shape& s = pending_[k];
+	if (!s.valid)
+		return;
+	if (size_ + pending_size_ + n > max_size_) {
+		invalidate(sid, cfg);
+		return;
+	}
+	s.size += n;
+	pending_size_ += n;
+	const SequenceSet& seqs = block.seqs();
+	atomic<int> next(range.begin());
+	vector<thread> threads;
+	for (int t = 0; t < config.threads_; ++t)
+		threads.emplace_back([&]() {
+		int p;
+		while ((p = next++) < range.end()) {
+			const SeedArray::Entry* it = seeds.begin(p), *end = it + seeds.size(p);
+			vector<Entry>& out = s.entries[p];
+			out.reserve(out.size() + (end - it));
+			for (; it < end; ++it) {
+				const auto l = seqs.local_position((uint64_t)it->value);
+				out.push_back({ it->key, (uint32_t)l.second, block.block_id2oid(l.first) });
+			}
+		}
+	});
+	for (auto& t : threads)
+		t.join();
+}
+
+SeedArray* SeedIndexCache::get(unsigned sid, const Block& block, const SeedPartitionRange& range, const Config& cfg) {
+	const auto it = shapes_.find(key(sid, cfg));
+	if (it == shapes_.end())
+		return nullptr;
+	const Shape& s = it->second;
+	const BlockId n = block.seqs().size();
+	vector<OId> oids(n);
+	for (BlockId i = 0; i < n; ++i) {
+		oids[i] = block.block_id2oid(i);
+		if ((i > 0 && oids[i] <= oids[i - 1]) || (s.filter && !s.filter->get(oids[i])))
+			return nullptr;
+	}
+	const SequenceSet& seqs = block.seqs();
+	std::array<vector<SeedArray::Entry>, Const::seedp> entries;
+	atomic<int> next(range.begin());
+	vector<thread> threads;
+	for (int t = 0; t < config.threads_; ++t)
+		threads.emplace_back([&]() {
+		int p;
+		while ((p = next++) < range.end()) {
+			vector<SeedArray::Entry>& out = entries[p];
+			for (const Entry& e : s.entries[p]) {
+				const auto i = std::lower_bound(oids.begin(), oids.end(), e.oid);
+				if (i == oids.end() || *i != e.oid)
+					continue;
+				const BlockId block_id = BlockId(i - oids.begin());
+				out.emplace_back(e.key, seqs.position(block_id, e.offset), (uint32_t)block_id);
+			}
+		}
+	});
+	for (auto& t : threads)
+		t.join();
+	return new SeedArray(cfg.seed_encoding, std::move(entries));
+}
+
+}
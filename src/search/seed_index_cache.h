@@ -0,0 +1,97 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2022 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <array>
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../basic/value.h"
+#include "../data/seed_array.h"
+#include "../util/data_structures/bit_vector.h"
+
+struct Block;
+struct Shape;
+struct SequenceFile;
+
+namespace Search {
+
+struct Config;
+
+// Reference seed arrays kept across consecutive searches of the same database (rounds of the cascaded clustering
+// workflow). Entries are stored per shape configuration together with the OId and offset of their sequence, so a
+// later search of a subset of the sequences can rebuild its reference seed array by filtering instead of
+// enumerating seeds. A shape is only reused once a search has stored it for every sequence it covered.
+struct SeedIndexCache {
+
+	// Only the shapes in reused (see shape_id()) are stored.
+	SeedIndexCache(size_t max_size, const std::set<std::string>& reused);
+	// Identifies a shape independently of the other parameters of a search.
+	static std::string shape_id(const ::Shape& shape, int minimizer_window);
+
+	void begin_search(const SequenceFile* db, const BitVector* filter);
+	void end_search();
+	// Returns nullptr if the shape is not cached for all sequences of the block.
+	SeedArray* get(unsigned sid, const Block& block, const SeedPartitionRange& range, const Config& cfg);
+	void put(unsigned sid, const Block& block, const SeedArray& seeds, const SeedPartitionRange& range, const Config& cfg);
+	// Marks a shape as not cacheable in the current search.
+	void invalidate(unsigned sid, const Config& cfg);
+
+	size_t size() const {
+		return size_;
+	}
+
+private:
+
+	struct Entry {
+		SeedOffset key;
+		uint32_t offset;
+		OId oid;
+	};
+
+	struct Shape {
+		Shape() :
+			valid(true),
+			size(0)
+		{}
+		std::array<std::vector<Entry>, Const::seedp> entries;
+		std::unique_ptr<BitVector> filter;
+		bool valid;
+		size_t size;
+	};
+
+	std::string key(unsigned sid, const Config& cfg) const;
+
+	std::map<std::string, Shape> shapes_, pending_;
+	const std::set<std::string> reused_;
+	const SequenceFile* db_;
+	int64_t db_seqs_;
+	const BitVector* filter_;
+	size_t size_, pending_size_;
+	const size_t max_size_;
+
+};
+
+extern std::unique_ptr<SeedIndexCache> seed_index_cache;
+
+}
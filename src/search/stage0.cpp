@@ -35,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/util.h"
 #include "../util/async_buffer.h"
 #include "seed_complexity.h"
+#include "seed_index_cache.h"
 
 using std::vector;
 using std::atomic;
@@ -113,17 +114,29 @@ void search_shape(unsigned sid, int query_block, unsigned query_iteration, char
 		current_range = range;
 
 		task_timer timer("Building reference seed array", true);
-		SeedArray *ref_idx;
+		SeedArray *ref_idx = nullptr;
 		const EnumCfg enum_ref{ &ref_hst.partition(), sid, sid + 1, cfg.seed_encoding, nullptr, false, false, cfg.seed_complexity_cut,
 			query_seeds_bitset.get() || query_seeds_hashed.get() ? MaskingAlgo::NONE : cfg.soft_masking,
 			cfg.minimizer_window };
-		if (query_seeds_bitset.get())
+		const bool cacheable = Search::seed_index_cache && !query_seeds_bitset && !query_seeds_hashed && !config.lin_stage1;
+		if (cacheable)
+			ref_idx = Search::seed_index_cache->get(sid, *cfg.target, range, cfg);
+		if (ref_idx)
+			log_stream << "Reference seed array loaded from cache." << endl;
+		else if (query_seeds_bitset.get())
 			ref_idx = new SeedArray(*cfg.target, ref_hst.get(sid), range, ref_buffer, query_seeds_bitset.get(), enum_ref);
 		else if (query_seeds_hashed.get())
 			ref_idx = new SeedArray(*cfg.target, ref_hst.get(sid), range, ref_buffer, query_seeds_hashed.get(), enum_ref);
 			//ref_idx = new SeedArray(ref_seqs, sid, range, query_seeds_hashed.get(), true);
-		else
+		else {
 			ref_idx = new SeedArray(*cfg.target, ref_hst.get(sid), range, ref_buffer, &no_filter, enum_ref);
+			if (cacheable && query_block == 0) {
+				timer.go("Caching reference seed array");
+				Search::seed_index_cache->put(sid, *cfg.target, *ref_idx, range, cfg);
+			}
+		}
+		if (Search::seed_index_cache && !cacheable && query_block == 0)
+			Search::seed_index_cache->invalidate(sid, cfg);
 
 		timer.go("Building query seed array");
 		SeedArray* query_idx;
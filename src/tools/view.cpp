@@ -145,7 +145,7 @@ void view_tsv() {
 	timer.go("Opening the output file");
 	OutputFile output_file(config.output_file);
 	OutputWriter writer{ &output_file };
-	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer));
+	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer, config.output_backlog));
 
 	timer.go("Loading database");
 	db_block = db->load_seqs(SIZE_MAX, nullptr, SequenceFile::LoadFlags::ALL);
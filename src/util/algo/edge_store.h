@@ -0,0 +1,207 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2022 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "algo.h"
+#include "varint.h"
+#include "../io/temp_file.h"
+#include "../io/input_file.h"
+#include "../data_structures/flat_array.h"
+#include "../../basic/config.h"
+
+namespace Util { namespace Algo {
+
+// Edge list that does not need to fit into memory. Edges are buffered up to buffer_size bytes, a full buffer is
+// sorted by (node1, node2) and written to a temporary file as compressed adjacency lists: for each source node the
+// delta to the previous source node and the edge count, followed by the delta encoded target nodes and the weights.
+// Reading merges these runs and returns the edges one source node at a time in ascending order (streaming CSR).
+// If the edges fit into the buffer, nothing is written to disk.
+template<typename Int>
+struct EdgeStore {
+
+	using Edge = Util::Algo::Edge<Int>;
+
+	EdgeStore(size_t buffer_size) :
+		max_buffer_(std::max(buffer_size / sizeof(Edge), (size_t)1)),
+		count_(0),
+		mem_pos_(0)
+	{}
+
+	void push(const Edge& e) {
+		// Grow the buffer explicitly so that its capacity never exceeds buffer_size.
+		if (buffer_.size() == buffer_.capacity())
+			buffer_.reserve(std::min(std::max(buffer_.capacity() * 2, (size_t)4096), max_buffer_));
+		buffer_.push_back(e);
+		++count_;
+		if (buffer_.size() >= max_buffer_)
+			flush();
+	}
+
+	int64_t size() const {
+		return count_;
+	}
+
+	bool spilled() const {
+		return !runs_.empty();
+	}
+
+	// Must be called after the last push and before next().
+	void init_read() {
+		if (runs_.empty())
+			ips4o::parallel::sort(buffer_.begin(), buffer_.end(), std::less<Edge>(), config.threads_);
+		else {
+			flush();
+			std::vector<Edge>().swap(buffer_);
+		}
+		mem_pos_ = 0;
+	}
+
+	// Reads the edges of the next source node into v, sorted by target node. Returns false if all edges were read.
+	bool next(std::vector<Edge>& v) {
+		v.clear();
+		if (runs_.empty()) {
+			if (mem_pos_ >= buffer_.size())
+				return false;
+			size_t i = mem_pos_;
+			while (i < buffer_.size() && buffer_[i].node1 == buffer_[mem_pos_].node1)
+				++i;
+			v.insert(v.end(), buffer_.begin() + mem_pos_, buffer_.begin() + i);
+			mem_pos_ = i;
+			return true;
+		}
+		Run* first = nullptr;
+		for (const auto& r : runs_)
+			if (r->good && (!first || r->node < first->node))
+				first = r.get();
+		if (!first)
+			return false;
+		const Int node = first->node;
+		int n = 0;
+		for (const auto& r : runs_)
+			if (r->good && r->node == node) {
+				v.insert(v.end(), r->edges.begin(), r->edges.end());
+				r->advance();
+				++n;
+			}
+		if (n > 1)
+			std::sort(v.begin(), v.end());
+		return true;
+	}
+
+	// Loads all edges into an array indexed by source node. Unlike make_flat_array_dense on the raw edges, this does
+	// not need a second copy of the edges if they were spilled to disk.
+	FlatArray<Edge> flat_array(Int node_count) {
+		if (runs_.empty()) {
+			FlatArray<Edge> r = make_flat_array_dense(std::move(buffer_), node_count, config.threads_, typename Edge::GetKey());
+			buffer_ = std::vector<Edge>();
+			return r;
+		}
+		init_read();
+		std::vector<int64_t> limits;
+		limits.reserve(node_count + 1);
+		limits.push_back(0);
+		std::vector<Edge> data, v;
+		data.reserve(count_);
+		while (next(v)) {
+			while ((Int)limits.size() <= v.front().node1)
+				limits.push_back(limits.back());
+			data.insert(data.end(), v.begin(), v.end());
+			limits.push_back((int64_t)data.size());
+		}
+		while ((Int)limits.size() <= node_count)
+			limits.push_back(limits.back());
+		return FlatArray<Edge>(std::move(limits), std::move(data));
+	}
+
+private:
+
+	struct Run {
+		Run(TempFile& f) :
+			in(f),
+			node(0),
+			good(true)
+		{
+			advance();
+		}
+		void advance() {
+			uint32_t d, n, t;
+			try {
+				read_varint(in, d);
+			}
+			catch (EndOfStream&) {
+				good = false;
+				in.close_and_delete();
+				return;
+			}
+			read_varint(in, n);
+			node += (Int)d;
+			edges.clear();
+			edges.reserve(n);
+			Int target = 0;
+			double weight;
+			for (uint32_t i = 0; i < n; ++i) {
+				read_varint(in, t);
+				target += (Int)t;
+				in.read(weight);
+				edges.emplace_back(node, target, weight);
+			}
+		}
+		InputFile in;
+		Int node;
+		std::vector<Edge> edges;
+		bool good;
+	};
+
+	void flush() {
+		if (buffer_.empty())
+			return;
+		ips4o::parallel::sort(buffer_.begin(), buffer_.end(), std::less<Edge>(), config.threads_);
+		TempFile f;
+		Int prev = 0;
+		for (auto i = buffer_.cbegin(); i < buffer_.cend();) {
+			auto j = i;
+			while (j < buffer_.cend() && j->node1 == i->node1)
+				++j;
+			write_varint(uint32_t(i->node1 - prev), f);
+			write_varint(uint32_t(j - i), f);
+			prev = i->node1;
+			Int target = 0;
+			for (; i < j; ++i) {
+				write_varint(uint32_t(i->node2 - target), f);
+				target = i->node2;
+				f.write(i->weight);
+			}
+		}
+		runs_.emplace_back(new Run(f));
+		buffer_.clear();
+	}
+
+	const size_t max_buffer_;
+	int64_t count_;
+	size_t mem_pos_;
+	std::vector<Edge> buffer_;
+	std::vector<std::unique_ptr<Run>> runs_;
+
+};
+
+}}
@@ -37,6 +37,11 @@ static inline size_t alloc_size(const std::pair<std::string, uint32_t>& x) {
 	return 4 + sizeof(std::string) + x.first.length();
 }
 
+template<typename _t>
+static inline size_t alloc_size(const std::pair<_t, std::string>& x) {
+	return sizeof(x) + x.second.length();
+}
+
 template<typename Type, typename Cmp = std::less<Type>>
 struct ExternalSorter {
 
@@ -21,14 +21,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <algorithm>
 #include <float.h>
 #include <queue>
+#include <atomic>
 #include "algo.h"
 #include "../log_stream.h"
+#include "../parallel/parallel_for.h"
+#include "../../basic/config.h"
 
 using std::vector;
 using std::priority_queue;
 using std::pair;
 using std::numeric_limits;
 using std::swap;
+using std::atomic;
 
 namespace Util { namespace Algo {
 
@@ -72,24 +76,80 @@ static Int neighbor_count(Int node, It begin, It end, const vector<Int>& centroi
 	return n;
 }
 
+// Points every node to the root of its assignment chain.
 template<typename Int>
 static void fix_assignment(vector<Int>& centroids) {
-	for (Int i = 0; i < (Int)centroids.size();) {
-		if (centroids[centroids[i]] != centroids[i])
-			centroids[i] = centroids[centroids[i]];
-		else
-			++i;
-	}
+	vector<Int> roots(centroids.size());
+	parallel_for((int64_t)centroids.size(), config.threads_, [&](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i) {
+			Int r = centroids[i];
+			while (centroids[r] != r)
+				r = centroids[r];
+			roots[i] = r;
+		}
+	});
+	centroids.swap(roots);
+}
+
+static void atomic_max(atomic<double>& x, double v) {
+	double y = x.load(std::memory_order_relaxed);
+	while (v > y && !x.compare_exchange_weak(y, v, std::memory_order_relaxed));
+}
+
+template<typename Int>
+static void atomic_min(atomic<Int>& x, Int v) {
+	Int y = x.load(std::memory_order_relaxed);
+	while (v < y && !x.compare_exchange_weak(y, v, std::memory_order_relaxed));
+}
+
+// Assigns every member to the centroid neighbor with the highest edge weight, ties going to the lowest centroid
+// id. This is the result of visiting the centroids in ascending order, computed in two parallel passes.
+template<typename Int>
+static void reassign(FlatArray<Edge<Int>>& neighbors, vector<Int>& centroids) {
+	const int64_t n = (int64_t)neighbors.size();
+	const double none = numeric_limits<double>::lowest();
+	vector<atomic<double>> weights(n);
+	vector<atomic<Int>> best(n);
+	parallel_for(n, config.threads_, [&](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i) {
+			weights[i].store(none, std::memory_order_relaxed);
+			best[i].store(numeric_limits<Int>::max(), std::memory_order_relaxed);
+		}
+	});
+	parallel_for(n, config.threads_, [&](int64_t begin, int64_t end) {
+		for (Int node = (Int)begin; node < (Int)end; ++node)
+			if (centroids[node] == node)
+				for (auto i = neighbors.cbegin(node); i != neighbors.cend(node); ++i)
+					if (centroids[i->node2] != i->node2)
+						atomic_max(weights[i->node2], i->weight);
+	});
+	parallel_for(n, config.threads_, [&](int64_t begin, int64_t end) {
+		for (Int node = (Int)begin; node < (Int)end; ++node)
+			if (centroids[node] == node)
+				for (auto i = neighbors.cbegin(node); i != neighbors.cend(node); ++i)
+					if (centroids[i->node2] != i->node2 && i->weight > none && i->weight == weights[i->node2].load(std::memory_order_relaxed))
+						atomic_min(best[i->node2], node);
+	});
+	parallel_for(n, config.threads_, [&](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i) {
+			const Int c = best[i].load(std::memory_order_relaxed);
+			if (c != numeric_limits<Int>::max())
+				centroids[i] = c;
+		}
+	});
 }
 
 template<typename Int>
 vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts, bool merge_recursive) {
 	task_timer timer("Computing edge counts");
-	priority_queue<pair<Int, Int>> q;
 	vector<Int> centroids(neighbors.size(), -1);
-	for (Int i = 0; i < neighbors.size(); ++i)
-		q.emplace(member_counts ? neighbor_count(i, neighbors.cbegin(i), neighbors.cend(i), centroids, member_counts) :
-			(Int)neighbors.count(i), i);
+	vector<pair<Int, Int>> counts(neighbors.size());
+	parallel_for((int64_t)neighbors.size(), config.threads_, [&](int64_t begin, int64_t end) {
+		for (Int i = (Int)begin; i < (Int)end; ++i)
+			counts[i] = { member_counts ? neighbor_count(i, neighbors.cbegin(i), neighbors.cend(i), centroids, member_counts) : (Int)neighbors.count(i), i };
+	});
+	// Nodes are unique in the queue, so the pop order does not depend on how the heap is built.
+	priority_queue<pair<Int, Int>> q(std::less<pair<Int, Int>>(), std::move(counts));
 
 	timer.go("Computing vertex cover");
 	while (!q.empty()) {
@@ -110,14 +170,7 @@ vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBloc
 	}
 
 	timer.go("Computing reassignment");
-	vector<double> weights(neighbors.size(), numeric_limits<double>::lowest());
-	for (Int node = 0; node < neighbors.size(); ++node)
-		if (centroids[node] == node)
-			for (auto i = neighbors.cbegin(node); i != neighbors.cend(node); ++i)
-				if (centroids[i->node2] != i->node2 && i->weight > weights[i->node2]) {
-					weights[i->node2] = i->weight;
-					centroids[i->node2] = node;
-				}
+	reassign(neighbors, centroids);
 
 	if (merge_recursive) {
 		timer.go("Computing merges");
@@ -55,6 +55,12 @@ struct BitVector {
 	void reset() {
 		std::fill(data_.begin(), data_.end(), 0);
 	}
+	void flip() {
+		for (uint64_t& x : data_)
+			x = ~x;
+		if (size_ & 63)
+			data_.back() &= (uint64_t(1) << (size_ & 63)) - 1;
+	}
 
 	size_t one_count() const {
 		size_t n = 0;
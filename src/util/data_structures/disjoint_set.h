@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include <vector>
+#include <atomic>
 #include "flat_array.h"
 
 template<typename Int>
@@ -68,4 +69,60 @@ private:
 
 	std::vector<Node> nodes_;
 
-};
\ No newline at end of file
+};
+
+// Union-find that can be fed from several threads at once. Roots are linked with a CAS so that the root with the
+// larger index points to the smaller one, find uses path halving. The representative of a set is its smallest element.
+template<typename Int>
+struct ConcurrentDisjointSet {
+
+	ConcurrentDisjointSet(Int size) :
+		parent_(size)
+	{
+		for (Int i = 0; i < size; ++i)
+			parent_[i].store(i, std::memory_order_relaxed);
+	}
+
+	Int size() const {
+		return (Int)parent_.size();
+	}
+
+	Int find(Int i) {
+		for (;;) {
+			Int p = parent_[i].load(std::memory_order_acquire);
+			if (p == i)
+				return i;
+			const Int g = parent_[p].load(std::memory_order_acquire);
+			if (g != p)
+				parent_[i].compare_exchange_weak(p, g, std::memory_order_acq_rel, std::memory_order_relaxed);
+			i = g;
+		}
+	}
+
+	void merge(Int i, Int j) {
+		for (;;) {
+			i = find(i);
+			j = find(j);
+			if (i == j)
+				return;
+			if (i < j)
+				std::swap(i, j);
+			Int expected = i;
+			if (parent_[i].compare_exchange_strong(expected, j, std::memory_order_acq_rel, std::memory_order_relaxed))
+				return;
+		}
+	}
+
+	// Not thread safe with respect to concurrent merges.
+	std::vector<Int> roots() {
+		std::vector<Int> r(parent_.size());
+		for (Int i = 0; i < (Int)parent_.size(); ++i)
+			r[i] = find(i);
+		return r;
+	}
+
+private:
+
+	std::vector<std::atomic<Int>> parent_;
+
+};
@@ -1,15 +1,27 @@
 #pragma once
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <algorithm>
 
+// Passes values pushed with consecutive sequence numbers to f in order. Out of order values are parked in a
+// ring buffer indexed by sequence number. If max_size is nonzero, producers of non-null values that are not
+// next in line block while the parked values would exceed max_size bytes (backpressure). The producer of the
+// next value never blocks, so this can not deadlock as long as every thread pushes its values in ascending order.
 template<typename T, typename F>
 struct ReorderQueue
 {
-	ReorderQueue(size_t begin, F& f) :
+	ReorderQueue(size_t begin, F& f, size_t max_size = 0) :
 		f_(f),
+		slots_(INIT_CAPACITY),
 		begin_(begin),
 		next_(begin),
 		size_(0),
-		max_size_(0)
+		max_size_(0),
+		limit_(max_size),
+		stalls_(0),
+		stall_time_(0)
 	{}
 
 	size_t size() const
@@ -27,36 +39,83 @@ struct ReorderQueue
 	size_t begin() const {
 		return begin_;
 	}
+	size_t stalls() const {
+		return stalls_;
+	}
+	// Total time in microseconds that producers were blocked by the size limit.
+	int64_t stall_time() const {
+		return stall_time_;
+	}
 
 	void push(size_t n, T value)
 	{
-		mtx_.lock();
-		//cout << "n=" << n << " next=" << next_ << endl;
+		std::unique_lock<std::mutex> lock(mtx_);
+		const size_t s = value ? value->alloc_size() : 0;
+		if (n != next_ && limit_ && s && size_ + s > limit_) {
+			const auto t0 = std::chrono::high_resolution_clock::now();
+			++stalls_;
+			cv_.wait(lock, [this, n, s] { return n == next_ || size_ + s <= limit_; });
+			stall_time_ += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+		}
 		if (n != next_) {
-			backlog_[n] = value;
-			size_ += value ? value->alloc_size() : 0;
+			if (n - next_ >= slots_.size())
+				grow(n - next_ + 1);
+			Slot& slot = slots_[n & (slots_.size() - 1)];
+			slot.value = value;
+			slot.set = true;
+			size_ += s;
 			max_size_ = std::max(max_size_, size_);
-			mtx_.unlock();
 		}
 		else
-			flush(value);
+			flush(value, lock);
 	}
 
 private:
 
-	void flush(T value)
+	enum { INIT_CAPACITY = 1024 };
+
+	struct Slot {
+		Slot() :
+			value(),
+			set(false)
+		{}
+		T value;
+		bool set;
+	};
+
+	void grow(size_t min_capacity) {
+		size_t cap = slots_.size();
+		while (cap < min_capacity)
+			cap *= 2;
+		std::vector<Slot> slots(cap);
+		const size_t mask = slots_.size() - 1;
+		for (size_t i = next_; i < next_ + slots_.size(); ++i)
+			slots[i & (cap - 1)] = slots_[i & mask];
+		slots_.swap(slots);
+	}
+
+	bool take(size_t n, T& value) {
+		Slot& slot = slots_[n & (slots_.size() - 1)];
+		if (!slot.set)
+			return false;
+		value = slot.value;
+		slot.value = T();
+		slot.set = false;
+		return true;
+	}
+
+	void flush(T value, std::unique_lock<std::mutex>& lock)
 	{
 		size_t n = next_ + 1;
 		std::vector<T> out;
 		out.push_back(value);
-		typename std::map<size_t, T>::iterator i;
+		T v;
 		do {
-			while ((i = backlog_.begin()) != backlog_.end() && i->first == n) {
-				out.push_back(i->second);
-				backlog_.erase(i);
+			while (take(n, v)) {
+				out.push_back(v);
 				++n;
 			}
-			mtx_.unlock();
+			lock.unlock();
 			size_t size = 0;
 			for (typename std::vector<T>::iterator j = out.begin(); j < out.end(); ++j) {
 				if (*j) {
@@ -67,15 +126,19 @@ private:
 				}
 			}
 			out.clear();
-			mtx_.lock();
+			lock.lock();
 			size_ -= size;
-		} while ((i = backlog_.begin()) != backlog_.end() && i->first == n);
+			cv_.notify_all();
+		} while (slots_[n & (slots_.size() - 1)].set);
 		next_ = n;
-		mtx_.unlock();
+		lock.unlock();
+		cv_.notify_all();
 	}
 
 	std::mutex mtx_;
+	std::condition_variable cv_;
 	F& f_;
-	std::map<size_t, T> backlog_;
-	size_t begin_, next_, size_, max_size_;
-};
\ No newline at end of file
+	std::vector<Slot> slots_;
+	size_t begin_, next_, size_, max_size_, limit_, stalls_;
+	int64_t stall_time_;
+};
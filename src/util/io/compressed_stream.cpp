@@ -17,9 +17,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <string.h>
 #include "compressed_stream.h"
 
 using std::pair;
+using std::vector;
+using std::thread;
 
 void ZlibSource::init()
 {
@@ -81,6 +87,161 @@ void ZlibSource::rewind()
 	init();
 }
 
+static uint16_t read_u16(const char* p) {
+	return (uint16_t)(unsigned char)p[0] | ((uint16_t)(unsigned char)p[1] << 8);
+}
+
+static uint32_t read_u32(const char* p) {
+	return (uint32_t)read_u16(p) | ((uint32_t)read_u16(p + 2) << 16);
+}
+
+bool BgzfSource::is_bgzf(const char* b, size_t n) {
+	return n >= 16 && b[0] == '\x1F' && b[1] == '\x8B' && b[2] == '\x08' && (b[3] & 4) && b[12] == 'B' && b[13] == 'C' && read_u16(b + 14) == 2;
+}
+
+BgzfSource::BgzfSource(StreamEntity *prev, int threads):
+	StreamEntity(prev),
+	threads_((size_t)std::max(threads, 1)),
+	batch_size_(threads_ * 64),
+	in_begin_(nullptr),
+	in_end_(nullptr),
+	out_pos_(0),
+	eos_(false)
+{
+}
+
+bool BgzfSource::read_raw(char* dst, size_t n) {
+	while (n > 0) {
+		if (in_begin_ == in_end_) {
+			pair<const char*, const char*> in = prev_->read();
+			in_begin_ = in.first;
+			in_end_ = in.second;
+			if (in_begin_ == in_end_)
+				return false;
+		}
+		const size_t m = std::min(n, size_t(in_end_ - in_begin_));
+		std::copy(in_begin_, in_begin_ + m, dst);
+		in_begin_ += m;
+		dst += m;
+		n -= m;
+	}
+	return true;
+}
+
+bool BgzfSource::read_block() {
+	const size_t begin = in_.size();
+	in_.resize(begin + HEADER_SIZE);
+	if (!read_raw(in_.data() + begin, HEADER_SIZE)) {
+		in_.resize(begin);
+		return false;
+	}
+	const char* h = in_.data() + begin;
+	if (h[0] != '\x1F' || h[1] != '\x8B' || !(h[3] & 4))
+		throw std::runtime_error("Invalid BGZF block header: " + file_name());
+	const size_t xlen = read_u16(h + 10);
+	in_.resize(begin + HEADER_SIZE + xlen);
+	if (!read_raw(in_.data() + begin + HEADER_SIZE, xlen))
+		throw std::runtime_error("Unexpected end of BGZF file: " + file_name());
+	size_t block_size = 0;
+	for (size_t i = begin + HEADER_SIZE; i + 4 <= begin + HEADER_SIZE + xlen; i += 4 + read_u16(in_.data() + i + 2))
+		if (in_[i] == 'B' && in_[i + 1] == 'C' && read_u16(in_.data() + i + 2) == 2)
+			block_size = (size_t)read_u16(in_.data() + i + 4) + 1;
+	if (block_size < HEADER_SIZE + xlen + 8)
+		throw std::runtime_error("Invalid BGZF block size: " + file_name());
+	in_.resize(begin + block_size);
+	if (!read_raw(in_.data() + begin + HEADER_SIZE + xlen, block_size - HEADER_SIZE - xlen))
+		throw std::runtime_error("Unexpected end of BGZF file: " + file_name());
+	const size_t out_size = read_u32(in_.data() + begin + block_size - 4),
+		out_begin = blocks_.empty() ? 0 : blocks_.back().out_begin + blocks_.back().out_size;
+	if (out_size > MAX_BLOCK_SIZE)
+		throw std::runtime_error("Invalid BGZF block size: " + file_name());
+	blocks_.push_back({ begin + HEADER_SIZE + xlen, block_size - HEADER_SIZE - xlen - 8, out_begin, out_size });
+	return true;
+}
+
+bool BgzfSource::fill() {
+	in_.clear();
+	blocks_.clear();
+	out_pos_ = 0;
+	while (blocks_.size() < batch_size_ && read_block());
+	if (blocks_.empty()) {
+		out_.clear();
+		return false;
+	}
+	out_.resize(blocks_.back().out_begin + blocks_.back().out_size);
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool> error(false);
+	auto worker = [&]() {
+		z_stream strm;
+		strm.zalloc = Z_NULL;
+		strm.zfree = Z_NULL;
+		strm.opaque = Z_NULL;
+		strm.avail_in = 0;
+		strm.next_in = Z_NULL;
+		if (inflateInit2(&strm, -15) != Z_OK) {
+			error = true;
+			return;
+		}
+		size_t i;
+		while ((i = next++) < blocks_.size() && !error) {
+			const Block& b = blocks_[i];
+			// An empty block (such as the EOF marker) has no output to inflate into, only its CRC is checked.
+			if (b.out_size == 0) {
+				if (crc32(0L, Z_NULL, 0) != read_u32(in_.data() + b.begin + b.size))
+					error = true;
+				continue;
+			}
+			inflateReset(&strm);
+			strm.next_in = (Bytef*)(in_.data() + b.begin);
+			strm.avail_in = (uInt)b.size;
+			strm.next_out = (Bytef*)(out_.data() + b.out_begin);
+			strm.avail_out = (uInt)b.out_size;
+			if (inflate(&strm, Z_FINISH) != Z_STREAM_END || strm.avail_out != 0
+				|| crc32(0L, (const Bytef*)(out_.data() + b.out_begin), (uInt)b.out_size) != read_u32(in_.data() + b.begin + b.size))
+				error = true;
+		}
+		inflateEnd(&strm);
+	};
+	const size_t n = std::min(threads_, blocks_.size());
+	vector<thread> threads;
+	for (size_t i = 1; i < n; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (thread& t : threads)
+		t.join();
+	if (error)
+		throw std::runtime_error("Inflate error.");
+	return true;
+}
+
+size_t BgzfSource::read(char *ptr, size_t count) {
+	size_t total = 0;
+	while (count > 0) {
+		if (out_pos_ == out_.size() && (eos_ || !fill())) {
+			eos_ = true;
+			break;
+		}
+		const size_t n = std::min(count, out_.size() - out_pos_);
+		memcpy(ptr, out_.data() + out_pos_, n);
+		out_pos_ += n;
+		ptr += n;
+		count -= n;
+		total += n;
+	}
+	return total;
+}
+
+void BgzfSource::rewind() {
+	prev_->rewind();
+	in_begin_ = in_end_ = nullptr;
+	in_.clear();
+	out_.clear();
+	blocks_.clear();
+	out_pos_ = 0;
+	eos_ = false;
+}
+
 ZlibSink::ZlibSink(StreamEntity *prev):
 	StreamEntity(prev)
 {
@@ -116,4 +277,174 @@ void ZlibSink::close()
 	deflate_loop(0, 0, Z_FINISH);
 	deflateEnd(&strm);
 	prev_->close();
-}
\ No newline at end of file
+}
+
+static const char BGZF_EOF[] = "\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00\x1b\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00";
+static const size_t BGZF_HEADER_SIZE = 18, BGZF_FOOTER_SIZE = 8, BGZF_MAX_BLOCK_SIZE = 1llu << 16;
+
+static void write_u16(char* p, uint16_t x) {
+	p[0] = (char)(x & 0xff);
+	p[1] = (char)(x >> 8);
+}
+
+static void write_u32(char* p, uint32_t x) {
+	write_u16(p, (uint16_t)(x & 0xffff));
+	write_u16(p + 2, (uint16_t)(x >> 16));
+}
+
+static size_t deflate_bgzf_block(const char* src, size_t n, char* dst, size_t capacity) {
+	static const char header[] = "\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00";
+	for (int level : { Z_DEFAULT_COMPRESSION, Z_NO_COMPRESSION }) {
+		z_stream strm;
+		strm.zalloc = Z_NULL;
+		strm.zfree = Z_NULL;
+		strm.opaque = Z_NULL;
+		if (deflateInit2(&strm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			throw std::runtime_error("deflateInit error");
+		strm.next_in = (Bytef*)src;
+		strm.avail_in = (uInt)n;
+		strm.next_out = (Bytef*)(dst + BGZF_HEADER_SIZE);
+		strm.avail_out = (uInt)(std::min(capacity, BGZF_MAX_BLOCK_SIZE) - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE);
+		const int ret = deflate(&strm, Z_FINISH);
+		const size_t c = strm.total_out;
+		deflateEnd(&strm);
+		if (ret != Z_STREAM_END)
+			continue;
+		const size_t size = BGZF_HEADER_SIZE + c + BGZF_FOOTER_SIZE;
+		memcpy(dst, header, 16);
+		write_u16(dst + 16, (uint16_t)(size - 1));
+		write_u32(dst + BGZF_HEADER_SIZE + c, (uint32_t)crc32(0L, (const Bytef*)src, (uInt)n));
+		write_u32(dst + BGZF_HEADER_SIZE + c + 4, (uint32_t)n);
+		return size;
+	}
+	throw std::runtime_error("deflate error");
+}
+
+ParallelBlockSink::ParallelBlockSink(StreamEntity *prev, int threads, size_t block_size, size_t max_compressed_size, BlockCompressor compressor):
+	StreamEntity(prev),
+	threads_((size_t)std::max(threads, 1)),
+	block_size_(block_size),
+	max_compressed_size_(max_compressed_size),
+	batch_size_(threads_ * std::max(((size_t)1 << 20) / block_size, (size_t)1) * block_size),
+	compressor_(compressor),
+	job_(nullptr),
+	finished_(false)
+{
+	in_.reserve(batch_size_);
+}
+
+void ParallelBlockSink::write_out(const char* ptr, size_t count) {
+	while (count > 0) {
+		pair<char*, char*> out = prev_->write_buffer();
+		const size_t n = std::min(count, size_t(out.second - out.first));
+		memcpy(out.first, ptr, n);
+		prev_->flush(n);
+		ptr += n;
+		count -= n;
+	}
+}
+
+void ParallelBlockSink::compress(ParallelBlockSink* sink) {
+	try {
+		const vector<char>& in = sink->job_in_;
+		const size_t block_size = sink->block_size_, capacity = sink->max_compressed_size_,
+			blocks = (in.size() + block_size - 1) / block_size;
+		vector<char> out(blocks * capacity);
+		vector<size_t> sizes(blocks);
+		std::atomic<size_t> next(0);
+		std::exception_ptr error;
+		std::atomic<bool> failed(false);
+		auto worker = [&]() {
+			size_t i;
+			try {
+				while ((i = next++) < blocks && !failed) {
+					const size_t begin = i * block_size;
+					sizes[i] = sink->compressor_(in.data() + begin, std::min(block_size, in.size() - begin), out.data() + i * capacity, capacity);
+				}
+			}
+			catch (...) {
+				if (!failed.exchange(true))
+					error = std::current_exception();
+			}
+		};
+		vector<thread> threads;
+		for (size_t i = 1; i < std::min(sink->threads_, blocks); ++i)
+			threads.emplace_back(worker);
+		worker();
+		for (thread& t : threads)
+			t.join();
+		if (error)
+			std::rethrow_exception(error);
+		for (size_t i = 0; i < blocks; ++i) {
+			sink->write_out(out.data() + i * capacity, sizes[i]);
+			sink->frames_.push_back({ (uint32_t)sizes[i], (uint32_t)std::min(block_size, in.size() - i * block_size) });
+		}
+	}
+	catch (...) {
+		sink->error_ = std::current_exception();
+	}
+}
+
+void ParallelBlockSink::join() {
+	if (job_) {
+		job_->join();
+		delete job_;
+		job_ = nullptr;
+	}
+	if (error_)
+		std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+void ParallelBlockSink::dispatch() {
+	join();
+	job_in_.swap(in_);
+	in_.clear();
+	job_ = new thread(compress, this);
+}
+
+void ParallelBlockSink::write(const char* ptr, size_t count) {
+	while (count > 0) {
+		const size_t n = std::min(count, batch_size_ - in_.size());
+		in_.insert(in_.end(), ptr, ptr + n);
+		ptr += n;
+		count -= n;
+		if (in_.size() == batch_size_)
+			dispatch();
+	}
+}
+
+void ParallelBlockSink::finish() {
+	if (finished_)
+		return;
+	finished_ = true;
+	if (!in_.empty())
+		dispatch();
+	join();
+	write_trailer();
+}
+
+void ParallelBlockSink::close() {
+	finish();
+	prev_->close();
+}
+
+void ParallelBlockSink::rewind() {
+	finish();
+	prev_->rewind();
+}
+
+ParallelBlockSink::~ParallelBlockSink() {
+	if (job_) {
+		job_->join();
+		delete job_;
+	}
+}
+
+BgzfSink::BgzfSink(StreamEntity *prev, int threads):
+	ParallelBlockSink(prev, threads, BLOCK_SIZE, BGZF_MAX_BLOCK_SIZE, deflate_bgzf_block)
+{
+}
+
+void BgzfSink::write_trailer() {
+	write_out(BGZF_EOF, sizeof(BGZF_EOF) - 1);
+}
@@ -18,6 +18,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include <string>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <stdint.h>
 #include <zlib.h>
 #include "stream_entity.h"
 
@@ -34,6 +38,30 @@ private:
 	bool eos_;
 };
 
+// Reader for BGZF files (concatenated gzip members of at most 64 KB carrying their compressed size
+// in a 'BC' extra field). Batches of blocks are inflated in parallel and returned in file order.
+struct BgzfSource : public StreamEntity
+{
+	BgzfSource(StreamEntity *prev, int threads);
+	virtual size_t read(char *ptr, size_t count);
+	virtual void rewind();
+	static bool is_bgzf(const char* header, size_t n);
+private:
+	bool read_raw(char* dst, size_t n);
+	bool read_block();
+	bool fill();
+	struct Block {
+		size_t begin, size, out_begin, out_size;
+	};
+	static const size_t HEADER_SIZE = 12, MAX_BLOCK_SIZE = 1llu << 16;
+	const size_t threads_, batch_size_;
+	const char *in_begin_, *in_end_;
+	std::vector<char> in_, out_;
+	std::vector<Block> blocks_;
+	size_t out_pos_;
+	bool eos_;
+};
+
 struct ZlibSink : public StreamEntity
 {
 	ZlibSink(StreamEntity *prev);
@@ -43,4 +71,49 @@ private:
 	void deflate_loop(const char *ptr, size_t count, int code);
 	static const size_t chunk_size = 1llu << 20;
 	z_stream strm;
-};
\ No newline at end of file
+};
+
+// Cuts the input into blocks of fixed size which are compressed independently by a pool of threads.
+// Batches are compressed in the background and written in order, so the output does not depend on
+// the number of threads. The compressed and uncompressed size of each block is kept for an index.
+struct ParallelBlockSink : public StreamEntity
+{
+	// Compresses n bytes from src into dst, which holds capacity bytes. Returns the compressed size.
+	typedef size_t (*BlockCompressor)(const char* src, size_t n, char* dst, size_t capacity);
+	ParallelBlockSink(StreamEntity *prev, int threads, size_t block_size, size_t max_compressed_size, BlockCompressor compressor);
+	virtual void close();
+	virtual void write(const char *ptr, size_t count);
+	// Finishes the stream and rewinds the underlying file, e.g. to read back a temporary file.
+	virtual void rewind();
+	virtual ~ParallelBlockSink();
+protected:
+	struct Frame {
+		uint32_t size, raw_size;
+	};
+	virtual void write_trailer() {}
+	void write_out(const char* ptr, size_t count);
+	const std::vector<Frame>& frames() const {
+		return frames_;
+	}
+private:
+	void finish();
+	void dispatch();
+	void join();
+	static void compress(ParallelBlockSink* sink);
+	const size_t threads_, block_size_, max_compressed_size_, batch_size_;
+	const BlockCompressor compressor_;
+	std::vector<char> in_, job_in_;
+	std::vector<Frame> frames_;
+	std::thread* job_;
+	std::exception_ptr error_;
+	bool finished_;
+};
+
+// Writer for BGZF files (blocks deflated as independent gzip members, followed by the BGZF EOF marker).
+struct BgzfSink : public ParallelBlockSink
+{
+	BgzfSink(StreamEntity *prev, int threads);
+	static const size_t BLOCK_SIZE = 65280;
+protected:
+	virtual void write_trailer();
+};
@@ -53,9 +53,11 @@ static StreamEntity* make_decompressor(const Compressor c, StreamEntity* buffer)
 	switch (c) {
 	case Compressor::ZLIB:
 		return new ZlibSource(buffer);
+	case Compressor::BGZF:
+		return new BgzfSource(buffer, config.threads_);
 	case Compressor::ZSTD:
 #ifdef WITH_ZSTD
-		return new ZstdSource(buffer);
+		return new ZstdSource(buffer, config.threads_);
 #else
 		throw std::runtime_error("Executable was not compiled with ZStd support.");
 #endif
@@ -84,8 +86,8 @@ InputFile::InputFile(const string &file_name, int flags) :
 	if (flags & NO_AUTODETECT)
 		return;
 	FileSource *source = dynamic_cast<FileSource*>(buffer_->root());
-	char b[4];
-	size_t n = source->read(b, 4);
+	char b[16];
+	size_t n = source->read(b, 16);
 	/*if (n == 2)
 		source->putback(b[1]);
 	if (n >= 1)
@@ -94,8 +96,9 @@ InputFile::InputFile(const string &file_name, int flags) :
 	if (n < 4)
 		return;
 	const auto c = detect_compressor(b);
-	if(c != Compressor::NONE)
-		buffer_ = new InputStreamBuffer(make_decompressor(c, buffer_));
+	// Decompression runs on a separate thread ahead of the consumer of the stream.
+	if (c != Compressor::NONE)
+		buffer_ = new InputStreamBuffer(make_decompressor(BgzfSource::is_bgzf(b, n) ? Compressor::BGZF : c, buffer_), InputStreamBuffer::ASYNC);
 }
 
 InputFile::InputFile(TempFile &tmp_file, int flags) :
@@ -105,6 +108,8 @@ InputFile::InputFile(TempFile &tmp_file, int flags) :
 	temp_file(true)
 {
 	tmp_file.rewind();
+	if (tmp_file.compressor() != Compressor::NONE)
+		buffer_ = new InputStreamBuffer(make_decompressor(tmp_file.compressor(), buffer_), InputStreamBuffer::ASYNC);
 }
 
 InputFile::InputFile(OutputFile& tmp_file, int flags) :
@@ -40,8 +40,23 @@ InputStreamBuffer::InputStreamBuffer(StreamEntity* prev, int flags) :
 {
 }
 
+InputStreamBuffer::~InputStreamBuffer()
+{
+	join_worker();
+}
+
+void InputStreamBuffer::join_worker()
+{
+	if (load_worker_) {
+		load_worker_->join();
+		delete load_worker_;
+		load_worker_ = nullptr;
+	}
+}
+
 void InputStreamBuffer::rewind()
 {
+	join_worker();
 	prev_->rewind();
 	file_offset_ = 0;
 	putback_count_ = 0;
@@ -49,12 +64,14 @@ void InputStreamBuffer::rewind()
 
 void InputStreamBuffer::seek(int64_t pos, int origin)
 {
+	join_worker();
 	prev_->seek(pos, origin);
 	file_offset_ = 0;
 }
 
 void InputStreamBuffer::seek_forward(size_t n)
 {
+	join_worker();
 	prev_->seek_forward(n);
 	file_offset_ = 0;
 }
@@ -68,9 +85,9 @@ pair<const char*, const char*> InputStreamBuffer::read()
 	}
 	else {
 		if (load_worker_) {
-			load_worker_->join();
-			delete load_worker_;
-			load_worker_ = nullptr;
+			join_worker();
+			if (load_error_)
+				std::rethrow_exception(std::exchange(load_error_, nullptr));
 			std::swap(buf_, load_buf_);
 			n = load_count_;
 		}
@@ -86,7 +103,13 @@ pair<const char*, const char*> InputStreamBuffer::read()
 }
 
 void InputStreamBuffer::load_worker(InputStreamBuffer* buf) {
-	buf->load_count_ = buf->prev_->read(buf->load_buf_.get(), buf->buf_size_);
+	try {
+		buf->load_count_ = buf->prev_->read(buf->load_buf_.get(), buf->buf_size_);
+	}
+	catch (...) {
+		buf->load_count_ = 0;
+		buf->load_error_ = std::current_exception();
+	}
 }
 
 void InputStreamBuffer::putback(const char* p, size_t n) {
@@ -95,11 +118,7 @@ void InputStreamBuffer::putback(const char* p, size_t n) {
 }
 
 void InputStreamBuffer::close() {
-	if (load_worker_) {
-		load_worker_->join();
-		delete load_worker_;
-		load_worker_ = nullptr;
-	}
+	join_worker();
 	prev_->close();
 }
 
@@ -31,13 +31,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using std::string;
 
-static StreamEntity* make_compressor(const Compressor c, StreamEntity* buffer) {
+static StreamEntity* make_compressor(const Compressor c, StreamEntity* buffer, int threads) {
 	switch (c) {
 	case Compressor::ZLIB:
 		return new ZlibSink(buffer);
+	case Compressor::BGZF:
+		return new BgzfSink(buffer, threads);
 	case Compressor::ZSTD:
 #ifdef WITH_ZSTD
-		return new ZstdSink(buffer);
+		return new ZstdSink(buffer, threads);
 #else
 		throw std::runtime_error("Executable was not compiled with ZStd support.");
 #endif
@@ -46,21 +48,27 @@ static StreamEntity* make_compressor(const Compressor c, StreamEntity* buffer) {
 	}
 }
 
-OutputFile::OutputFile(const string &file_name, Compressor compressor, const char *mode) :
+OutputFile::OutputFile(const string &file_name, Compressor compressor, const char *mode, int threads) :
 	Serializer(new OutputStreamBuffer(new FileSink(file_name, mode))),
-	file_name_(file_name)
+	file_name_(file_name),
+	compressor_(compressor)
 {
 	if (compressor != Compressor::NONE) {
-		buffer_ = new OutputStreamBuffer(make_compressor(compressor, buffer_));
+		buffer_ = new OutputStreamBuffer(make_compressor(compressor, buffer_, threads));
 		reset_buffer();
 	}
 }
 
 #ifndef _MSC_VER
-OutputFile::OutputFile(std::pair<std::string, int> fd, const char *mode):
+OutputFile::OutputFile(std::pair<std::string, int> fd, const char *mode, Compressor compressor, int threads):
 	Serializer(new OutputStreamBuffer(new FileSink(fd.first, fd.second, mode))),
-	file_name_(fd.first)
+	file_name_(fd.first),
+	compressor_(compressor)
 {
+	if (compressor != Compressor::NONE) {
+		buffer_ = new OutputStreamBuffer(make_compressor(compressor, buffer_, threads));
+		reset_buffer();
+	}
 }
 #endif
 
@@ -24,13 +24,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "serializer.h"
 #include "../text_buffer.h"
 
-enum class Compressor { NONE, ZLIB, ZSTD };
+// BGZF is gzip compatible output that is compressed in parallel, used for temporary files.
+enum class Compressor { NONE, ZLIB, ZSTD, BGZF };
 
 struct OutputFile : public Serializer
 {
-	OutputFile(const std::string &file_name, Compressor compressor = Compressor::NONE, const char *mode = "wb");
+	OutputFile(const std::string &file_name, Compressor compressor = Compressor::NONE, const char *mode = "wb", int threads = 1);
 #ifndef _MSC_VER
-	OutputFile(std::pair<std::string, int> fd, const char *mode);
+	OutputFile(std::pair<std::string, int> fd, const char *mode, Compressor compressor = Compressor::NONE, int threads = 1);
 #endif
 
 	void remove();
@@ -51,8 +52,14 @@ struct OutputFile : public Serializer
 		return file_name_;
 	}
 
+	Compressor compressor() const
+	{
+		return compressor_;
+	}
+
 protected:
 
 	std::string file_name_;
+	Compressor compressor_;
 
 };
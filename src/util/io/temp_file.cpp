@@ -79,11 +79,11 @@ pair<string, int> TempFile::init(bool unlink)
 #endif
 }
 
-TempFile::TempFile(bool unlink):
+TempFile::TempFile(bool unlink, Compressor compressor, int threads):
 #ifdef _MSC_VER
-	OutputFile(init(unlink), Compressor::NONE, "w+b")
+	OutputFile(init(unlink), compressor, "w+b", threads)
 #else
-	OutputFile(init(unlink), "w+b")
+	OutputFile(init(unlink), "w+b", compressor, threads)
 #endif
 {
 }
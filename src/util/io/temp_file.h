@@ -23,7 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 struct TempFile : public OutputFile
 {
 
-	TempFile(bool unlink = true);
+	TempFile(bool unlink = true, Compressor compressor = Compressor::NONE, int threads = 1);
 	TempFile(const std::string & file_name);
 	virtual void finalize() override {}
 	static std::string get_temp_dir();
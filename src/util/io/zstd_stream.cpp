@@ -1,92 +1,275 @@
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <string.h>
 #include "zstd_stream.h"
 
 using std::pair;
+using std::vector;
+using std::thread;
 
-ZstdSink::ZstdSink(StreamEntity* prev) :
-	StreamEntity(prev),
-	stream(ZSTD_createCStream())
-{
-	if (!stream)
-		throw std::runtime_error("ZSTD_createCStream error");
+static size_t compress_frame(const char* src, size_t n, char* dst, size_t capacity) {
+	const size_t size = ZSTD_compress(dst, capacity, src, n, ZSTD_CLEVEL_DEFAULT);
+	if (ZSTD_isError(size))
+		throw std::runtime_error("ZSTD_compress");
+	return size;
 }
 
-void ZstdSink::write(const char* ptr, size_t count)
+static void put_u32(vector<char>& buf, uint32_t x) {
+	for (int i = 0; i < 4; ++i)
+		buf.push_back((char)(x >> (8 * i)));
+}
+
+ZstdSink::ZstdSink(StreamEntity* prev, int threads) :
+	ParallelBlockSink(prev, threads, FRAME_SIZE, ZSTD_compressBound(FRAME_SIZE), compress_frame)
 {
-	ZSTD_inBuffer in_buf;
-	in_buf.src = ptr;
-	in_buf.size = count;
-	in_buf.pos = 0;
-	ZSTD_outBuffer out_buf;
-	do {
-		pair<char*, char*> out = prev_->write_buffer();
-		out_buf.dst = out.first;
-		out_buf.size = out.second - out.first;
-		out_buf.pos = 0;
-		if(ZSTD_isError(ZSTD_compressStream(stream, &out_buf, &in_buf)))
-			throw std::runtime_error("ZSTD_compressStream");
-		prev_->flush(out_buf.pos);
-	} while (in_buf.pos < in_buf.size);
 }
 
-void ZstdSink::close()
+void ZstdSink::write_trailer()
 {
-	if (!stream)
-		return;
-	ZSTD_outBuffer out_buf;
-	size_t n;
-	do {
-		pair<char*, char*> out = prev_->write_buffer();
-		out_buf.dst = out.first;
-		out_buf.size = out.second - out.first;
-		out_buf.pos = 0;
-		if (ZSTD_isError(n = ZSTD_endStream(stream, &out_buf)))
-			throw std::runtime_error("ZSTD_endStream");
-		prev_->flush(out_buf.pos);
-	} while (n > 0);
-	ZSTD_freeCStream(stream);
-	stream = nullptr;
-	prev_->close();
+	static const uint32_t SKIPPABLE_MAGIC = 0x184D2A5E, SEEKABLE_MAGIC = 0x8F92EAB1;
+	vector<char> buf;
+	put_u32(buf, SKIPPABLE_MAGIC);
+	put_u32(buf, (uint32_t)(frames().size() * 8 + 9));
+	for (const Frame& f : frames()) {
+		put_u32(buf, f.size);
+		put_u32(buf, f.raw_size);
+	}
+	put_u32(buf, (uint32_t)frames().size());
+	buf.push_back('\0');
+	put_u32(buf, SEEKABLE_MAGIC);
+	write_out(buf.data(), buf.size());
 }
 
-ZstdSource::ZstdSource(StreamEntity* prev):
-StreamEntity(prev)
+static uint32_t read_u32(const char* p) {
+	uint32_t x = 0;
+	for (int i = 3; i >= 0; --i)
+		x = (x << 8) | (unsigned char)p[i];
+	return x;
+}
+
+ZstdSource::ZstdSource(StreamEntity* prev, int threads):
+	StreamEntity(prev),
+	threads_((size_t)std::max(threads, 1)),
+	batch_size_(threads_ * 4),
+	stream(nullptr)
 {
 	init();
 }
 
-
 void ZstdSource::init()
 {
+	if (!stream)
+		stream = ZSTD_createDStream();
+	ZSTD_initDStream(stream);
+	in_begin_ = in_end_ = nullptr;
+	in_.clear();
+	out_.clear();
+	header_.clear();
+	frames_.clear();
+	out_pos_ = 0;
+	header_pos_ = 0;
+	streamed_ = false;
+	streamed_pending_ = false;
 	eos_ = false;
-	stream = ZSTD_createDStream();
-	in_buf.pos = 0;
-	in_buf.size = 0;
-	in_buf.src = nullptr;
 }
 
-size_t ZstdSource::read(char* ptr, size_t count)
+bool ZstdSource::read_raw(char* dst, size_t n) {
+	while (n > 0) {
+		if (in_begin_ == in_end_) {
+			pair<const char*, const char*> in = prev_->read();
+			in_begin_ = in.first;
+			in_end_ = in.second;
+			if (in_begin_ == in_end_)
+				return false;
+		}
+		const size_t m = std::min(n, size_t(in_end_ - in_begin_));
+		std::copy(in_begin_, in_begin_ + m, dst);
+		in_begin_ += m;
+		dst += m;
+		n -= m;
+	}
+	return true;
+}
+
+// Reads the next frame. Frames of known content size up to MAX_FRAME_SIZE are appended to the batch, for other frames
+// only the header is read into header_ and the rest is left to the streaming decoder.
+ZstdSource::FrameType ZstdSource::read_frame() {
+	static const uint32_t MAGIC = 0xFD2FB528, SKIPPABLE_MAGIC = 0x184D2A50;
+	header_.resize(5);
+	if (!read_raw(header_.data(), 4))
+		return FrameType::NONE;
+	const uint32_t magic = read_u32(header_.data());
+	if ((magic & 0xFFFFFFF0) == SKIPPABLE_MAGIC) {
+		char size[4];
+		if (!read_raw(size, 4))
+			throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+		vector<char> buf(read_u32(size));
+		if (!read_raw(buf.data(), buf.size()))
+			throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+		return FrameType::SKIPPABLE;
+	}
+	if (magic != MAGIC)
+		throw std::runtime_error("Invalid zstd frame: " + file_name());
+	if (!read_raw(header_.data() + 4, 1))
+		throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+	// Header size from the frame header descriptor: window descriptor, dictionary id and content size fields
+	static const size_t DICT_ID_SIZE[] = { 0, 1, 2, 4 }, CONTENT_SIZE_SIZE[] = { 0, 2, 4, 8 };
+	const unsigned char descriptor = (unsigned char)header_[4];
+	const bool single_segment = descriptor & 0x20;
+	const size_t content_size_size = (descriptor >> 6) == 0 ? (single_segment ? 1 : 0) : CONTENT_SIZE_SIZE[descriptor >> 6];
+	header_.resize(5 + (single_segment ? 0 : 1) + DICT_ID_SIZE[descriptor & 3] + content_size_size);
+	if (!read_raw(header_.data() + 5, header_.size() - 5))
+		throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+	const unsigned long long content_size = ZSTD_getFrameContentSize(header_.data(), header_.size());
+	if (content_size == ZSTD_CONTENTSIZE_ERROR)
+		throw std::runtime_error("Invalid zstd frame: " + file_name());
+	if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size > MAX_FRAME_SIZE) {
+		header_pos_ = 0;
+		return FrameType::STREAMED;
+	}
+
+	const size_t begin = in_.size(), out_begin = frames_.empty() ? 0 : frames_.back().out_begin + frames_.back().out_size;
+	in_.insert(in_.end(), header_.begin(), header_.end());
+	bool last;
+	do {
+		char h[3];
+		if (!read_raw(h, 3))
+			throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+		const uint32_t block_header = (uint32_t)(unsigned char)h[0] | ((uint32_t)(unsigned char)h[1] << 8) | ((uint32_t)(unsigned char)h[2] << 16);
+		last = block_header & 1;
+		const uint32_t type = (block_header >> 1) & 3;
+		if (type == 3)
+			throw std::runtime_error("Invalid zstd block: " + file_name());
+		const size_t size = type == 1 ? 1 : block_header >> 3;
+		in_.insert(in_.end(), h, h + 3);
+		in_.resize(in_.size() + size);
+		if (!read_raw(in_.data() + in_.size() - size, size))
+			throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+	} while (!last);
+	// Content checksum flag of the frame header descriptor
+	if (header_[4] & 4) {
+		in_.resize(in_.size() + 4);
+		if (!read_raw(in_.data() + in_.size() - 4, 4))
+			throw std::runtime_error("Unexpected end of zstd file: " + file_name());
+	}
+	frames_.push_back({ begin, in_.size() - begin, out_begin, (size_t)content_size });
+	return FrameType::BATCHED;
+}
+
+bool ZstdSource::fill() {
+	in_.clear();
+	frames_.clear();
+	out_pos_ = 0;
+	FrameType t = FrameType::SKIPPABLE;
+	while (frames_.size() < batch_size_ && (t = read_frame()) != FrameType::NONE && t != FrameType::STREAMED);
+	streamed_pending_ = t == FrameType::STREAMED;
+	out_.resize(frames_.empty() ? 0 : frames_.back().out_begin + frames_.back().out_size);
+	if (frames_.empty())
+		return streamed_pending_;
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool> error(false);
+	auto worker = [&]() {
+		ZSTD_DCtx* ctx = ZSTD_createDCtx();
+		if (!ctx) {
+			error = true;
+			return;
+		}
+		char empty;
+		size_t i;
+		while ((i = next++) < frames_.size() && !error) {
+			const Frame& f = frames_[i];
+			const size_t n = ZSTD_decompressDCtx(ctx, f.out_size ? out_.data() + f.out_begin : &empty, f.out_size, in_.data() + f.begin, f.size);
+			if (ZSTD_isError(n) || n != f.out_size)
+				error = true;
+		}
+		ZSTD_freeDCtx(ctx);
+	};
+	const size_t n = std::min(threads_, frames_.size());
+	vector<thread> threads;
+	for (size_t i = 1; i < n; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (thread& t : threads)
+		t.join();
+	if (error)
+		throw std::runtime_error("ZSTD_decompressDCtx");
+	return true;
+}
+
+// Decompresses the frame whose header is in header_ directly from the input stream.
+size_t ZstdSource::read_streamed(char* ptr, size_t count)
 {
 	ZSTD_outBuffer out_buf;
 	out_buf.dst = ptr;
 	out_buf.pos = 0;
 	out_buf.size = count;
-	while (out_buf.pos < out_buf.size && !eos_) {
-		if (in_buf.pos >= in_buf.size) {
-			pair<const char*, const char*> in = prev_->read();
-			in_buf.pos = 0;
-			in_buf.size = in.second - in.first;
-			in_buf.src = in.first;
-			if (in_buf.size == 0) {
-				eos_ = true;
-				break;
+	while (out_buf.pos < out_buf.size && streamed_) {
+		ZSTD_inBuffer in_buf;
+		const bool header = header_pos_ < header_.size();
+		if (header) {
+			in_buf.src = header_.data();
+			in_buf.size = header_.size();
+			in_buf.pos = header_pos_;
+		}
+		else {
+			if (in_begin_ == in_end_) {
+				pair<const char*, const char*> in = prev_->read();
+				in_begin_ = in.first;
+				in_end_ = in.second;
+				if (in_begin_ == in_end_)
+					throw std::runtime_error("Unexpected end of zstd file: " + file_name());
 			}
+			in_buf.src = in_begin_;
+			in_buf.size = in_end_ - in_begin_;
+			in_buf.pos = 0;
 		}
-		if (ZSTD_isError(ZSTD_decompressStream(stream, &out_buf, &in_buf)))
+		const size_t r = ZSTD_decompressStream(stream, &out_buf, &in_buf);
+		if (ZSTD_isError(r))
 			throw std::runtime_error("ZSTD_decompressStream");
+		if (header)
+			header_pos_ = in_buf.pos;
+		else
+			in_begin_ += in_buf.pos;
+		if (r == 0)
+			streamed_ = false;
 	}
 	return out_buf.pos;
 }
 
+size_t ZstdSource::read(char* ptr, size_t count)
+{
+	size_t total = 0;
+	while (count > 0) {
+		size_t n;
+		if (streamed_)
+			n = read_streamed(ptr, count);
+		else if (out_pos_ < out_.size()) {
+			n = std::min(count, out_.size() - out_pos_);
+			memcpy(ptr, out_.data() + out_pos_, n);
+			out_pos_ += n;
+		}
+		else if (streamed_pending_) {
+			ZSTD_initDStream(stream);
+			streamed_pending_ = false;
+			streamed_ = true;
+			continue;
+		}
+		else if (eos_ || !fill()) {
+			eos_ = true;
+			break;
+		}
+		else
+			continue;
+		ptr += n;
+		count -= n;
+		total += n;
+	}
+	return total;
+}
+
 void ZstdSource::close()
 {
 	if (!stream)
@@ -96,8 +279,14 @@ void ZstdSource::close()
 	prev_->close();
 }
 
+ZstdSource::~ZstdSource()
+{
+	if (stream)
+		ZSTD_freeDStream(stream);
+}
+
 void ZstdSource::rewind()
 {
 	prev_->rewind();
 	init();
-}
\ No newline at end of file
+}
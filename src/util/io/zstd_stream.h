@@ -1,25 +1,45 @@
 #pragma once
+#include <vector>
 #include <zstd.h>
 #include "stream_entity.h"
+#include "compressed_stream.h"
 
-struct ZstdSink : public StreamEntity
+// Writes independent zstd frames of FRAME_SIZE input bytes, compressed by a pool of threads. The
+// stream ends with a seek table in the zstd seekable format (a skippable frame that decoders ignore).
+struct ZstdSink : public ParallelBlockSink
 {
-	ZstdSink(StreamEntity* prev);
-	virtual void close();
-	virtual void write(const char* ptr, size_t count);
-private:
-	ZSTD_CStream* stream;
+	ZstdSink(StreamEntity* prev, int threads);
+	static const size_t FRAME_SIZE = 1llu << 20;
+protected:
+	virtual void write_trailer();
 };
 
+// Reads a zstd stream. Frames whose content size is stored in the header (such as the ones written by ZstdSink) are
+// collected in batches and decompressed by a pool of threads. Frames of unknown or large content size are decompressed
+// by streaming. Skippable frames are ignored.
 struct ZstdSource : public StreamEntity
 {
-	ZstdSource(StreamEntity* prev);
+	ZstdSource(StreamEntity* prev, int threads);
 	virtual size_t read(char* ptr, size_t count);
 	virtual void close();
 	virtual void rewind();
+	virtual ~ZstdSource();
 private:
+	enum class FrameType { NONE, SKIPPABLE, BATCHED, STREAMED };
+	bool read_raw(char* dst, size_t n);
+	FrameType read_frame();
+	bool fill();
+	size_t read_streamed(char* ptr, size_t count);
 	void init();
+	struct Frame {
+		size_t begin, size, out_begin, out_size;
+	};
+	static const size_t MAX_FRAME_SIZE = 1llu << 22;
+	const size_t threads_, batch_size_;
 	ZSTD_DStream* stream;
-	ZSTD_inBuffer in_buf;
-	bool eos_;
-};
\ No newline at end of file
+	const char *in_begin_, *in_end_;
+	std::vector<char> in_, out_, header_;
+	std::vector<Frame> frames_;
+	size_t out_pos_, header_pos_;
+	bool streamed_, streamed_pending_, eos_;
+};
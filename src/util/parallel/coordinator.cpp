@@ -0,0 +1,505 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#ifndef WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#include "multiprocessing.h"
+#include "coordinator.h"
+#include "filestack.h"
+#include "../log_stream.h"
+
+using namespace std;
+
+static const int CONNECT_RETRIES = 100;
+static const double CONNECT_RETRY_WAIT_S = 0.1;
+
+#ifndef WIN32
+
+static int open_socket(const string & address, bool server) {
+    int fd;
+    if (address.compare(0, 5, "unix:") == 0) {
+        const string path = address.substr(5);
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        if (path.empty() || path.length() >= sizeof(addr.sun_path))
+            throw runtime_error("Invalid coordinator socket path: " + path);
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            throw runtime_error("could not create socket for coordinator " + address);
+        if (server) {
+            unlink(path.c_str());
+            if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+                close(fd);
+                throw runtime_error("could not listen on coordinator address " + address);
+            }
+        }
+        else if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    const size_t colon = address.rfind(':');
+    if (colon == string::npos)
+        throw runtime_error("Invalid coordinator address (expected unix:PATH or HOST:PORT): " + address);
+    const string host = address.substr(0, colon), port = address.substr(colon + 1);
+    addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (server)
+        hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0)
+        throw runtime_error("could not resolve coordinator address " + address);
+    fd = -1;
+    for (addrinfo* p = res; p != nullptr && fd == -1; p = p->ai_next) {
+        fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (fd == -1)
+            continue;
+        if (server) {
+            const int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (::bind(fd, p->ai_addr, p->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        else {
+            if (connect(fd, p->ai_addr, p->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+            else {
+                const int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+    }
+    freeaddrinfo(res);
+    if (fd == -1 && server)
+        throw runtime_error("could not listen on coordinator address " + address);
+    return fd;
+}
+
+static bool send_all(int fd, const string & buf) {
+    size_t n = 0;
+    while (n < buf.size()) {
+        const ssize_t k = send(fd, buf.data() + n, buf.size() - n, MSG_NOSIGNAL);
+        if (k <= 0)
+            return false;
+        n += k;
+    }
+    return true;
+}
+
+static bool read_line(int fd, string & read_buf, string & line) {
+    size_t nl;
+    char raw[4096];
+    while ((nl = read_buf.find('\n')) == string::npos) {
+        const ssize_t k = recv(fd, raw, sizeof(raw), 0);
+        if (k <= 0)
+            return false;
+        read_buf.append(raw, k);
+    }
+    line.assign(read_buf, 0, nl);
+    read_buf.erase(0, nl + 1);
+    return true;
+}
+
+#endif
+
+static void check_field(const string & s) {
+    if (s.find_first_of("\t\n") != string::npos)
+        throw runtime_error("Invalid character in work stack entry: " + s);
+}
+
+CoordinatorConnection::CoordinatorConnection(const string & address) : fd(-1), address(address) {
+#ifndef WIN32
+    for (int i = 0; i < CONNECT_RETRIES && fd == -1; ++i) {
+        fd = open_socket(address, false);
+        if (fd == -1)
+            this_thread::sleep_for(chrono::duration<double>(CONNECT_RETRY_WAIT_S));
+    }
+    if (fd == -1)
+        throw runtime_error("could not connect to coordinator " + address);
+#else
+    throw runtime_error("The multiprocessing coordinator is not supported on Windows.");
+#endif
+}
+
+CoordinatorConnection::~CoordinatorConnection() {
+#ifndef WIN32
+    if (fd != -1)
+        close(fd);
+#endif
+}
+
+string CoordinatorConnection::request(const string & op, const string & name, const string & arg, int64_t & value) {
+#ifndef WIN32
+    lock_guard<mutex> lock(mtx);
+    string line;
+    if (!send_all(fd, op + '\t' + name + '\t' + arg + '\n') || !read_line(fd, read_buf, line))
+        throw runtime_error("lost connection to coordinator " + address);
+    const size_t i = line.find('\t'), j = i == string::npos ? i : line.find('\t', i + 1);
+    if (i == string::npos)
+        throw runtime_error("invalid reply from coordinator " + address);
+    const string payload = j == string::npos ? string() : line.substr(j + 1);
+    if (line.compare(0, i, "OK") != 0)
+        throw runtime_error(payload);
+    value = stoll(line.substr(i + 1, j - i - 1));
+    return payload;
+#else
+    return string();
+#endif
+}
+
+SocketStack::SocketStack(const shared_ptr<CoordinatorConnection> & connection, const string & file_name) :
+    connection(connection),
+    file_name(file_name)
+{
+    check_field(file_name);
+}
+
+size_t SocketStack::size() {
+    int64_t n;
+    connection->request("SIZE", file_name, "", n);
+    return (size_t)n;
+}
+
+int SocketStack::pop(string & buf, size_t & size_after_pop) {
+    int64_t n;
+    buf = connection->request("POP", file_name, "", n);
+    size_after_pop = (size_t)n;
+    return (int)buf.size();
+}
+
+int SocketStack::pop(string & buf) {
+    size_t n;
+    return pop(buf, n);
+}
+
+int SocketStack::top(string & buf) {
+    int64_t n;
+    buf = connection->request("TOP", file_name, "", n);
+    return (int)buf.size();
+}
+
+int SocketStack::remove(const string & line) {
+    check_field(line);
+    int64_t n;
+    connection->request("REMOVE", file_name, line, n);
+    return 0;
+}
+
+int64_t SocketStack::push(const string & buf, size_t & size_after_push) {
+    const string line = (!buf.empty() && buf.back() == '\n') ? buf.substr(0, buf.size() - 1) : buf;
+    check_field(line);
+    int64_t n;
+    connection->request("PUSH", file_name, line, n);
+    size_after_push = (size_t)n;
+    return (int64_t)line.size() + 1;
+}
+
+int64_t SocketStack::push(const string & buf) {
+    size_t n;
+    return push(buf, n);
+}
+
+int64_t SocketStack::push_non_locked(const string & buf) {
+    return push(buf);
+}
+
+int SocketStack::clear() {
+    int64_t n;
+    connection->request("CLEAR", file_name, "", n);
+    return 0;
+}
+
+vector<string> SocketStack::lines() {
+    int64_t n;
+    const string payload = connection->request("LINES", file_name, "", n);
+    return n > 0 ? split(payload, '\t') : vector<string>();
+}
+
+// Waits run on a connection of their own, so that other threads of the process can use the shared connection
+// in the meantime.
+bool SocketStack::poll_query(const string & query, const double sleep_s, const size_t max_iter) {
+    check_field(query);
+    int64_t n;
+    const int64_t timeout_ms = (int64_t)(sleep_s * max_iter * 1000);
+    CoordinatorConnection(connection->get_address()).request("WAIT_QUERY", file_name, query + '\t' + to_string(timeout_ms), n);
+    return true;
+}
+
+bool SocketStack::poll_size(const size_t size, const double sleep_s, const size_t max_iter) {
+    int64_t n;
+    const int64_t timeout_ms = (int64_t)(sleep_s * max_iter * 1000);
+    CoordinatorConnection(connection->get_address()).request("WAIT_SIZE", file_name, to_string(size) + '\t' + to_string(timeout_ms), n);
+    return true;
+}
+
+#ifndef WIN32
+
+namespace {
+
+struct Coordinator {
+
+    // The log of a stack is rewritten once it has more than this many records and twice as many as entries.
+    static const size_t COMPACT_MIN_RECORDS = 1024;
+
+    Coordinator() :
+        stopped(false)
+    {}
+
+    struct Stack {
+        Stack() :
+            records(0)
+        {}
+        vector<string> lines;
+        size_t records;
+        unique_ptr<ofstream> log;
+    };
+
+    Stack & get(const string & name) {
+        auto it = stacks.find(name);
+        if (it != stacks.end())
+            return it->second;
+        Stack & s = stacks[name];
+        ifstream in(name);
+        string line;
+        while (getline(in, line)) {
+            apply_stack_record(s.lines, line);
+            ++s.records;
+        }
+        return s;
+    }
+
+    // Rewrites the log of the stack as plain lines.
+    static void compact(const string & name, Stack & s) {
+        s.log.reset();
+        const string tmp = name + ".tmp";
+        {
+            ofstream out(tmp, ios::trunc);
+            for (const string & line : s.lines)
+                out << line << '\n';
+            if (!out)
+                throw runtime_error("could not write file " + tmp);
+        }
+        if (rename(tmp.c_str(), name.c_str()) != 0)
+            throw runtime_error("could not write file " + name);
+        s.records = s.lines.size();
+    }
+
+    // Appends a record to the log of the stack, rewrites the log as plain lines if it has grown too long.
+    static void append(const string & name, Stack & s, const string & record) {
+        apply_stack_record(s.lines, record);
+        if (++s.records > COMPACT_MIN_RECORDS && s.records > 2 * s.lines.size()) {
+            compact(name, s);
+            return;
+        }
+        if (!s.log)
+            s.log.reset(new ofstream(name, ios::app));
+        *s.log << record << '\n' << flush;
+        if (!*s.log)
+            throw runtime_error("could not write file " + name);
+    }
+
+    string handle(const vector<string> & req) {
+        if (req.size() < 2)
+            throw runtime_error("invalid request");
+        const string & op = req[0], & name = req[1];
+        const string arg = req.size() > 2 ? req[2] : string();
+        unique_lock<mutex> lock(mtx);
+        if (stopped)
+            throw runtime_error("coordinator is shutting down");
+        Stack & s = get(name);
+        if (op == "SIZE")
+            return "OK\t" + to_string(s.lines.size()) + '\t';
+        if (op == "TOP")
+            return "OK\t" + to_string(s.lines.size()) + '\t' + (s.lines.empty() ? string() : s.lines.back());
+        if (op == "LINES") {
+            string r;
+            for (const string & line : s.lines)
+                r += (r.empty() ? "" : "\t") + line;
+            return "OK\t" + to_string(s.lines.size()) + '\t' + r;
+        }
+        if (op == "POP") {
+            string line;
+            if (!s.lines.empty()) {
+                line = s.lines.back();
+                append(name, s, "\tPOP");
+                cv.notify_all();
+            }
+            return "OK\t" + to_string(s.lines.size()) + '\t' + line;
+        }
+        if (op == "PUSH") {
+            append(name, s, arg);
+            cv.notify_all();
+            return "OK\t" + to_string(s.lines.size()) + '\t';
+        }
+        if (op == "REMOVE") {
+            append(name, s, "\tREMOVE\t" + arg);
+            cv.notify_all();
+            return "OK\t" + to_string(s.lines.size()) + '\t';
+        }
+        if (op == "CLEAR") {
+            append(name, s, "\tCLEAR");
+            cv.notify_all();
+            return "OK\t0\t";
+        }
+        if (op == "WAIT_QUERY" || op == "WAIT_SIZE") {
+            if (req.size() < 4)
+                throw runtime_error("invalid request");
+            const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(stoll(req[3]));
+            bool stop = false;
+            auto ready = [&]() {
+                if (op == "WAIT_SIZE")
+                    return s.lines.size() == stoull(arg);
+                const string top = s.lines.empty() ? string() : s.lines.back();
+                stop = top.find("STOP") != string::npos;
+                return top.find(arg) != string::npos || stop;
+            };
+            if (!cv.wait_until(lock, deadline, [&]() { return stopped || ready(); }))
+                return "ERR\t0\t" + string(op == "WAIT_SIZE" ? "Could not detect size " + arg + " of FileStack " + name
+                    : "Could not discover keyword " + arg + " on FileStack " + name) + " within " + req[3] + " ms.";
+            if (stopped)
+                throw runtime_error("coordinator is shutting down");
+            if (stop && op == "WAIT_QUERY" && s.lines.back().find(arg) == string::npos)
+                return "ERR\t0\tSTOP on FileStack " + name;
+            return "OK\t" + to_string(s.lines.size()) + '\t';
+        }
+        throw runtime_error("unknown operation " + op);
+    }
+
+    void serve(int fd) {
+        string read_buf, line;
+        while (read_line(fd, read_buf, line)) {
+            string reply;
+            try {
+                reply = handle(split(line, '\t'));
+            }
+            catch (const exception & e) {
+                reply = string("ERR\t0\t") + e.what();
+            }
+            if (!send_all(fd, reply + '\n'))
+                break;
+        }
+        lock_guard<mutex> lock(mtx);
+        clients.erase(fd);
+        close(fd);
+        cv.notify_all();
+    }
+
+    // Returns false if the coordinator is shutting down.
+    bool add_client(int fd) {
+        lock_guard<mutex> lock(mtx);
+        if (stopped)
+            return false;
+        clients.insert(fd);
+        return true;
+    }
+
+    void wait_clients() {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [this]() { return clients.empty(); });
+    }
+
+    // Leaves all stack files as plain lines and rejects further requests.
+    void stop() {
+        lock_guard<mutex> lock(mtx);
+        stopped = true;
+        for (auto & s : stacks)
+            if (s.second.records != s.second.lines.size())
+                compact(s.first, s.second);
+        for (int fd : clients)
+            shutdown(fd, SHUT_RDWR);
+        cv.notify_all();
+    }
+
+    mutex mtx;
+    condition_variable cv;
+    unordered_map<string, Stack> stacks;
+    unordered_set<int> clients;
+    bool stopped;
+
+};
+
+}
+
+void run_coordinator(const string & address) {
+    // SIGINT and SIGTERM are handled by a thread of their own, which compacts the stack files before shutting down.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    const int fd = open_socket(address, true);
+    Coordinator coordinator;
+    atomic<bool> stop(false);
+    thread signal_handler([&]() {
+        int sig;
+        sigwait(&signals, &sig);
+        try {
+            coordinator.stop();
+        }
+        catch (const exception & e) {
+            message_stream << "Error: " << e.what() << endl;
+        }
+        stop = true;
+        shutdown(fd, SHUT_RDWR);
+    });
+    message_stream << "Coordinator listening on " << address << endl;
+    for (;;) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client == -1) {
+            if (stop)
+                break;
+            continue;
+        }
+        if (address.compare(0, 5, "unix:") != 0) {
+            const int one = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        if (!coordinator.add_client(client)) {
+            close(client);
+            continue;
+        }
+        thread(&Coordinator::serve, &coordinator, client).detach();
+    }
+    signal_handler.join();
+    coordinator.wait_clients();
+    close(fd);
+    message_stream << "Coordinator stopped" << endl;
+}
+
+#else
+
+void run_coordinator(const string & address) {
+    throw runtime_error("The multiprocessing coordinator is not supported on Windows.");
+}
+
+#endif
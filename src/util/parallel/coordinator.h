@@ -0,0 +1,69 @@
+#ifndef _COORDINATOR_H_
+#define _COORDINATOR_H_
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "work_stack.h"
+
+// Socket backend for the multiprocessing work stacks. The coordinator process keeps all stacks in memory and
+// persists them to the same file names that FileStack would use, so todo/wip/done semantics and --mp-recover are
+// unchanged. Each file is a log: pushed lines are appended as they are, pops, removals and clears are appended as
+// records starting with a tab (which entries can not contain). The coordinator replays the log when it first opens
+// a stack and rewrites it as plain lines once the records outnumber the entries, and for all stacks when it receives
+// SIGINT or SIGTERM. FileStack also replays and rewrites a log that it opens. Clients connect via "unix:PATH"
+// or "HOST:PORT" and exchange one tab-separated request/reply line per operation. poll_query/poll_size block on
+// the coordinator on a separate connection instead of sleeping on the client.
+
+class CoordinatorConnection {
+    public:
+        CoordinatorConnection(const std::string & address);
+        ~CoordinatorConnection();
+
+        // Sends a request and returns the reply payload, sets value to the integer field of the reply.
+        std::string request(const std::string & op, const std::string & name, const std::string & arg, int64_t & value);
+
+        const std::string & get_address() const {
+            return address;
+        }
+
+    private:
+        int fd;
+        std::string address;
+        std::string read_buf;
+        std::mutex mtx;
+};
+
+class SocketStack : public WorkStack {
+    public:
+        SocketStack(const std::shared_ptr<CoordinatorConnection> & connection, const std::string & file_name);
+
+        size_t size() override;
+
+        int pop(std::string & buf) override;
+        int pop(std::string & buf, size_t & size_after_pop) override;
+        int top(std::string & buf) override;
+
+        int remove(const std::string & line) override;
+
+        int64_t push(const std::string & buf) override;
+        int64_t push(const std::string & buf, size_t & size_after_push) override;
+        int64_t push_non_locked(const std::string & buf) override;
+
+        int clear() override;
+
+        std::vector<std::string> lines() override;
+
+        bool poll_query(const std::string & query, const double sleep_s=0.5, const size_t max_iter=7200) override;
+        bool poll_size(const size_t size, const double sleep_s=0.5, const size_t max_iter=7200) override;
+
+    private:
+        std::shared_ptr<CoordinatorConnection> connection;
+        std::string file_name;
+};
+
+// Runs the coordinator until the process is terminated.
+void run_coordinator(const std::string & address);
+
+#endif
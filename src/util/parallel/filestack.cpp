@@ -28,6 +28,24 @@ const string default_file_name = "default_stack.idx";
 const int default_max_line_length = 4096;
 
 
+void apply_stack_record(vector<string> & lines, const string & record) {
+    if (record.empty() || record[0] != '\t') {
+        lines.push_back(record);
+        return;
+    }
+    if (record == "\tPOP") {
+        if (!lines.empty())
+            lines.pop_back();
+    }
+    else if (record == "\tCLEAR")
+        lines.clear();
+    else if (record.compare(0, 8, "\tREMOVE\t") == 0)
+        lines.erase(std::remove(lines.begin(), lines.end(), record.substr(8)), lines.end());
+    else
+        throw runtime_error("invalid record in work stack file: " + record);
+}
+
+
 FileStack::FileStack() : FileStack::FileStack(default_file_name) {
     std::cerr << "FileStack: Using default file name " << default_file_name << std::endl;
 }
@@ -45,6 +63,7 @@ FileStack::FileStack(const string & file_name, int maximum_line_length) {
     this->locked = false;
     this->file_name = file_name;
     set_max_line_length(maximum_line_length);
+    replay_log();
 #endif
 }
 
@@ -354,6 +373,60 @@ int FileStack::clear() {
     return stat;
 }
 
+// A stack file left behind by the coordinator may still be a log, replay it and rewrite it as plain lines.
+void FileStack::replay_log() {
+    DBG("");
+#ifndef WIN32
+    lock();
+    const off_t size = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    string buf(size, '\0');
+    const ssize_t n_read = read(fd, &buf[0], size);
+    buf.resize(n_read > 0 ? n_read : 0);
+    if ((!buf.empty() && buf[0] == '\t') || buf.find("\n\t") != string::npos) {
+        vector<string> lines;
+        size_t begin = 0, end;
+        while ((end = buf.find('\n', begin)) != string::npos) {
+            apply_stack_record(lines, buf.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        buf.clear();
+        for (const string & line : lines)
+            buf += line + '\n';
+        lseek(fd, 0, SEEK_SET);
+        if (ftruncate(fd, 0) != 0 || write(fd, buf.data(), buf.size()) != (ssize_t)buf.size()) {
+            unlock();
+            throw runtime_error("could not write file " + file_name);
+        }
+    }
+    unlock();
+#endif
+}
+
+vector<string> FileStack::lines() {
+    DBG("");
+    vector<string> r;
+#ifndef WIN32
+    bool locked_internally = false;
+    if (! locked) {
+        lock();
+        locked_internally = true;
+    }
+    const off_t size = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    string buf(size, '\0');
+    const ssize_t n_read = read(fd, &buf[0], size);
+    buf.resize(n_read > 0 ? n_read : 0);
+    for (const string & line : split(buf, '\n'))
+        if (!line.empty())
+            r.push_back(line);
+    if (locked_internally) {
+        unlock();
+    }
+#endif
+    return r;
+}
+
 
 
 bool FileStack::poll_query(const string & query, const double sleep_s, const size_t max_iter) {
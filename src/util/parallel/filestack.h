@@ -2,6 +2,8 @@
 #define _FILESTACK_H_
 
 #include <string>
+#include <vector>
+#include "work_stack.h"
 #ifndef WIN32
 #include <unistd.h>
 #include <fcntl.h>
@@ -15,40 +17,45 @@
 #endif
 
 
-class FileStack {
+// Applies a record of a work stack log as written by the coordinator (see coordinator.h) to the entries.
+void apply_stack_record(std::vector<std::string> & lines, const std::string & record);
+
+class FileStack : public WorkStack {
     public:
         FileStack();
         FileStack(const std::string & file_name);
         FileStack(const std::string & file_name, int maximum_line_length);
-        ~FileStack();
+        ~FileStack() override;
 
-        size_t size();
+        size_t size() override;
 
         int pop(int & i);
-        int pop(std::string & buf);
-        int pop(std::string & buf, size_t & size_after_pop);
+        int pop(std::string & buf) override;
+        int pop(std::string & buf, size_t & size_after_pop) override;
         int pop_non_locked(std::string & buf);
 
         int top(int & i);
-        int top(std::string & buf);
+        int top(std::string & buf) override;
 
-        int remove(const std::string & line);
+        int remove(const std::string & line) override;
 
         int64_t push(int i);
-        int64_t push(const std::string & buf);
-        int64_t push(const std::string & buf, size_t & size_after_push);
-        int64_t push_non_locked(const std::string & buf);
+        int64_t push(const std::string & buf) override;
+        int64_t push(const std::string & buf, size_t & size_after_push) override;
+        int64_t push_non_locked(const std::string & buf) override;
 
         int get_max_line_length();
         int set_max_line_length(int n);
 
-        int clear();
+        int clear() override;
+
+        std::vector<std::string> lines() override;
 
         int lock();
         int unlock();
 
-        bool poll_query(const std::string & query, const double sleep_s=0.5, const size_t max_iter=7200);
-        bool poll_size(const size_t size, const double sleep_s=0.5, const size_t max_iter=7200);
+        bool poll_query(const std::string & query, const double sleep_s=0.5, const size_t max_iter=7200) override;
+        bool poll_size(const size_t size, const double sleep_s=0.5, const size_t max_iter=7200) override;
 
     private:
         int fd;
@@ -60,6 +67,7 @@ class FileStack {
         off_t max_line_length;
 
         int pop(std::string &, const bool, size_t &);
+        void replay_log();
         int pop_non_locked(std::string &, const bool, size_t &);
 };
 
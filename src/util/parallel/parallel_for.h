@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Calls f(begin, end) for consecutive chunks of [0, n), distributed dynamically over up to num_threads threads.
+template<typename F>
+void parallel_for(const int64_t n, const int num_threads, F f, int64_t chunk_size = 0) {
+	if (chunk_size <= 0)
+		chunk_size = std::max(n / (std::max(num_threads, 1) * 16), (int64_t)1);
+	if (num_threads <= 1 || n <= chunk_size) {
+		if (n > 0)
+			f((int64_t)0, n);
+		return;
+	}
+	std::atomic<int64_t> next(0);
+	auto worker = [&]() {
+		int64_t begin;
+		while ((begin = next.fetch_add(chunk_size)) < n)
+			f(begin, std::min(begin + chunk_size, n));
+	};
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; ++i)
+		threads.emplace_back(worker);
+	for (auto& t : threads)
+		t.join();
+}
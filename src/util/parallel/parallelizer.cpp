@@ -123,28 +123,28 @@ bool Parallelizer::barrier(const string & tag) {
 
     auto cmd_file_name = get_barrier_file_name("cmd", tag, i_barrier);
     DBG(cmd_file_name);
-    auto cmd_fs = FileStack(cmd_file_name);
+    auto cmd_fs = open_stack(cmd_file_name);
     auto ack_file_name = get_barrier_file_name("ack", tag, i_barrier);
     DBG(ack_file_name);
-    auto ack_fs = FileStack(ack_file_name);
+    auto ack_fs = open_stack(ack_file_name);
 
     static const string msg = "WAIT";
     if (is_master()) {
-        ack_fs.clear();
-        cmd_fs.push(msg);
+        ack_fs->clear();
+        cmd_fs->push(msg);
     }
-    cmd_fs.poll_query(msg);
-    ack_fs.push(id);
+    cmd_fs->poll_query(msg);
+    ack_fs->push(id);
 
     DBG(msg);
 
     static const string msg_ok = "GOON";
     if (is_master()) {
         const size_t n_workers = get_stack(WORKERS)->size();
-        ack_fs.poll_size(n_workers);
-        cmd_fs.push(msg_ok);
+        ack_fs->poll_size(n_workers);
+        cmd_fs->push(msg_ok);
     }
-    cmd_fs.poll_query(msg_ok);
+    cmd_fs->poll_query(msg_ok);
 
     DBG(msg_ok);
 
@@ -191,13 +191,28 @@ bool Parallelizer::create_stack(const std::string & tag, std::string sfx) {
 
 bool Parallelizer::create_stack_from_file(const std::string & tag, const std::string & file_name) {
     delete_stack(tag);
-    fs_map.emplace(tag, shared_ptr<FileStack>(new FileStack(file_name)));
+    fs_map.emplace(tag, open_stack(file_name));
     DBG(file_name);
     return true;
 }
 
 
-std::shared_ptr<FileStack> Parallelizer::get_stack(const std::string & tag) {
+void Parallelizer::set_coordinator(const std::string & address) {
+    if (address.empty())
+        coordinator.reset();
+    else
+        coordinator.reset(new CoordinatorConnection(address));
+}
+
+
+std::shared_ptr<WorkStack> Parallelizer::open_stack(const std::string & file_name) {
+    if (coordinator)
+        return shared_ptr<WorkStack>(new SocketStack(coordinator, file_name));
+    return shared_ptr<WorkStack>(new FileStack(file_name));
+}
+
+
+std::shared_ptr<WorkStack> Parallelizer::get_stack(const std::string & tag) {
 	// cerr << __PRETTY_FUNCTION__ << endl;
     return fs_map.at(tag);
 }
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <algorithm>
 #include "filestack.h"
+#include "coordinator.h"
 
 #define AUTOTAG std::string(__FUNCTION__)+"_"+std::to_string(__LINE__)
 
@@ -30,9 +31,13 @@ class Parallelizer {
 
         bool create_stack_from_file(const std::string & tag, const std::string & file_name);
 
+        // Use the coordinator at the given address instead of lock files for all stacks opened later.
+        void set_coordinator(const std::string & address);
+        std::shared_ptr<WorkStack> open_stack(const std::string & file_name);
+
         bool create_stack(const std::string & tag, std::string sfx="");
         bool delete_stack(const std::string & tag);
-        std::shared_ptr<FileStack> get_stack(const std::string & tag);
+        std::shared_ptr<WorkStack> get_stack(const std::string & tag);
 
         static void sleep(const double sleep_s);
 
@@ -68,7 +73,8 @@ class Parallelizer {
         std::vector<std::string> continuous_cleanup_list;
         std::vector<std::string> final_cleanup_list;
 
-        std::unordered_map<std::string, std::shared_ptr<FileStack>> fs_map;
+        std::unordered_map<std::string, std::shared_ptr<WorkStack>> fs_map;
+        std::shared_ptr<CoordinatorConnection> coordinator;
 };
 
 #endif
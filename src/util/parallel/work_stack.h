@@ -0,0 +1,35 @@
+#ifndef _WORK_STACK_H_
+#define _WORK_STACK_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Line-based work stack shared by the processes of a multiprocessing run. Implemented on top of
+// lock files (FileStack) or a coordinator process (SocketStack).
+class WorkStack {
+    public:
+        virtual ~WorkStack() {}
+
+        virtual size_t size() = 0;
+
+        virtual int pop(std::string & buf) = 0;
+        virtual int pop(std::string & buf, size_t & size_after_pop) = 0;
+        virtual int top(std::string & buf) = 0;
+
+        virtual int remove(const std::string & line) = 0;
+
+        virtual int64_t push(const std::string & buf) = 0;
+        virtual int64_t push(const std::string & buf, size_t & size_after_push) = 0;
+        virtual int64_t push_non_locked(const std::string & buf) = 0;
+
+        virtual int clear() = 0;
+
+        // Returns the entries from bottom to top.
+        virtual std::vector<std::string> lines() = 0;
+
+        virtual bool poll_query(const std::string & query, const double sleep_s=0.5, const size_t max_iter=7200) = 0;
+        virtual bool poll_size(const size_t size, const double sleep_s=0.5, const size_t max_iter=7200) = 0;
+};
+
+#endif
@@ -46,12 +46,116 @@ std::string convert_size(size_t size);
 
 namespace Util { namespace String {
 
+// Integer formatting equivalent to sprintf(p, "%llu", x) / sprintf(p, "%lli", x).
+inline int format_uint(unsigned long long x, char* p) {
+	static const char digits[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	char buf[24];
+	char* q = buf + sizeof(buf);
+	while (x >= 100) {
+		q -= 2;
+		memcpy(q, digits + 2 * (x % 100), 2);
+		x /= 100;
+	}
+	if (x >= 10) {
+		q -= 2;
+		memcpy(q, digits + 2 * x, 2);
+	}
+	else
+		*--q = char('0' + x);
+	const int n = int(buf + sizeof(buf) - q);
+	memcpy(p, q, n);
+	p[n] = '\0';
+	return n;
+}
+
+inline int format_int(long long x, char* p) {
+	if (x < 0) {
+		*p = '-';
+		return 1 + format_uint(0llu - (unsigned long long)x, p + 1);
+	}
+	return format_uint((unsigned long long)x, p);
+}
+
 // Workaround since sprintf is inconsistent in double rounding for different implementations.
 inline int format_double(double x, char *p) {
 	if (x >= 100.0)
-		return sprintf(p, "%lli", (long long)std::floor(x)); // for keeping output compatible with BLAST
+		return format_int((long long)std::floor(x), p); // for keeping output compatible with BLAST
 	long long i = std::llround(x*10.0);
-	return sprintf(p, "%lli.%lli", i / 10, i % 10);
+	int n = format_int(i / 10, p);
+	p[n++] = '.';
+	return n + format_int(i % 10, p + n);
+}
+
+// a * 10^k for |k| <= 308 (relative error of a few ulp).
+inline double scale_pow10(double a, int k) {
+	static const std::vector<double> pow10 = [] {
+		std::vector<double> v(309);
+		for (int i = 0; i < 309; ++i)
+			v[i] = std::pow(10.0, i);
+		return v;
+	}();
+	return k >= 0 ? a * pow10[k] : a / pow10[-k];
+}
+
+// Equivalent to sprintf(p, "%.2e", x). The mantissa is computed in floating point and the result falls
+// back to sprintf when it is too close to a rounding tie to be decided reliably.
+inline int format_e2(double x, char* p) {
+	const double a = std::fabs(x);
+	if (!(a >= 1e-290 && a <= 1e290))
+		return sprintf(p, "%.2e", x);
+	int e = (int)std::floor(std::log10(a));
+	double m = scale_pow10(a, 2 - e);
+	if (m >= 1000.0)
+		m = scale_pow10(a, 2 - ++e);
+	else if (m < 100.0)
+		m = scale_pow10(a, 2 - --e);
+	if (std::fabs(m - std::floor(m) - 0.5) < 1e-6)
+		return sprintf(p, "%.2e", x);
+	int d = (int)(m + 0.5);
+	if (d == 1000) {
+		d = 100;
+		++e;
+	}
+	char* q = p;
+	if (std::signbit(x))
+		*q++ = '-';
+	q[0] = char('0' + d / 100);
+	q[1] = '.';
+	q[2] = char('0' + d / 10 % 10);
+	q[3] = char('0' + d % 10);
+	q[4] = 'e';
+	q[5] = e < 0 ? '-' : '+';
+	q += 6;
+	const int ae = std::abs(e);
+	if (ae < 10)
+		*q++ = '0';
+	q += format_uint(ae, q);
+	return int(q - p);
+}
+
+// Equivalent to sprintf(p, "%f", x), with the same fallback as format_e2.
+inline int format_f6(double x, char* p) {
+	const double a = std::fabs(x);
+	if (!(a < 1e4))
+		return sprintf(p, "%f", x);
+	const double m = a * 1e6;
+	if (std::fabs(m - std::floor(m) - 0.5) < 1e-4)
+		return sprintf(p, "%f", x);
+	const unsigned long long n = (unsigned long long)(m + 0.5);
+	char* q = p;
+	if (std::signbit(x))
+		*q++ = '-';
+	q += format_uint(n / 1000000, q);
+	*q++ = '.';
+	unsigned long long f = n % 1000000;
+	for (int i = 5; i >= 0; --i, f /= 10)
+		q[i] = char('0' + f % 10);
+	q += 6;
+	*q = '\0';
+	return int(q - p);
 }
 
 std::string replace(const std::string& s, char a, char b);
@@ -0,0 +1,188 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2022 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <new>
+#include "shared_segment.h"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#endif
+
+using std::string;
+using std::runtime_error;
+
+// Attaching processes wait at most 60s for the creator to publish the segment.
+static const int WAIT_MS = 10, MAX_WAIT_ITER = 6000;
+
+SharedSegment::SharedSegment(const string& name, int fd, char* ptr, char* payload, size_t mapped_size) :
+	name_(name),
+	fd_(fd),
+	ptr_(ptr),
+	payload_(payload),
+	mapped_size_(mapped_size)
+{}
+
+SharedSegment::Header* SharedSegment::header() const {
+	return (Header*)ptr_;
+}
+
+const char* SharedSegment::data() const {
+	return (payload_ ? payload_ : ptr_) + HEADER_SIZE;
+}
+
+char* SharedSegment::data() {
+	return (payload_ ? payload_ : ptr_) + HEADER_SIZE;
+}
+
+size_t SharedSegment::size() const {
+	return header()->size;
+}
+
+#ifdef WIN32
+
+SharedSegment* SharedSegment::attach(const string& name) {
+	throw runtime_error("Shared memory segments are not supported on Windows.");
+}
+
+SharedSegment* SharedSegment::create(const string& name, size_t size) {
+	throw runtime_error("Shared memory segments are not supported on Windows.");
+}
+
+void SharedSegment::publish() {
+}
+
+SharedSegment::~SharedSegment() {
+}
+
+#else
+
+static bool process_alive(int64_t pid) {
+	return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+}
+
+SharedSegment* SharedSegment::attach(const string& name) {
+	const int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd == -1) {
+		if (errno == ENOENT)
+			return nullptr;
+		throw runtime_error("Error opening shared memory segment: " + name);
+	}
+	struct stat sb;
+	int n = 0;
+	do {
+		if (fstat(fd, &sb) == -1) {
+			close(fd);
+			throw runtime_error("Error calling fstat on shared memory segment: " + name);
+		}
+		if ((size_t)sb.st_size >= HEADER_SIZE)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+	} while (++n < MAX_WAIT_ITER);
+	if ((size_t)sb.st_size < HEADER_SIZE) {
+		close(fd);
+		return nullptr;
+	}
+	char* ptr = (char*)mmap(nullptr, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		throw runtime_error("Error calling mmap on shared memory segment: " + name);
+	}
+	Header* h = (Header*)ptr;
+	auto fail = [&]() {
+		munmap(ptr, sb.st_size);
+		close(fd);
+		return nullptr;
+	};
+	if (h->magic != MAGIC_NUMBER)
+		return fail();
+	for (n = 0; h->state.load(std::memory_order_acquire) != READY; ++n) {
+		if (n >= MAX_WAIT_ITER)
+			return fail();
+		if (!process_alive(h->creator_pid)) {
+			// The segment can never be published, remove the name so that it can be created again.
+			shm_unlink(name.c_str());
+			return fail();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+	}
+	// A reference is only taken while the count is positive, so a segment that is being unlinked is not revived.
+	int32_t refs = h->refs.load(std::memory_order_acquire);
+	do {
+		if (refs <= 0)
+			return fail();
+	} while (!h->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_acq_rel));
+	char* payload = (char*)mmap(nullptr, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (payload == MAP_FAILED) {
+		SharedSegment s(name, fd, ptr, nullptr, sb.st_size);
+		throw runtime_error("Error calling mmap on shared memory segment: " + name);
+	}
+	return new SharedSegment(name, fd, ptr, payload, sb.st_size);
+}
+
+SharedSegment* SharedSegment::create(const string& name, size_t size) {
+	const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd == -1) {
+		if (errno == EEXIST)
+			return nullptr;
+		throw runtime_error("Error creating shared memory segment: " + name);
+	}
+	const size_t mapped_size = HEADER_SIZE + size;
+	if (ftruncate(fd, mapped_size) != 0) {
+		close(fd);
+		shm_unlink(name.c_str());
+		throw runtime_error("Error allocating shared memory segment: " + name);
+	}
+	char* ptr = (char*)mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		shm_unlink(name.c_str());
+		throw runtime_error("Error calling mmap on shared memory segment: " + name);
+	}
+	Header* h = new(ptr) Header;
+	h->magic = MAGIC_NUMBER;
+	h->size = size;
+	h->refs.store(1, std::memory_order_relaxed);
+	h->creator_pid = (int64_t)getpid();
+	h->state.store(INIT, std::memory_order_release);
+	return new SharedSegment(name, fd, ptr, nullptr, mapped_size);
+}
+
+void SharedSegment::publish() {
+	header()->state.store(READY, std::memory_order_release);
+}
+
+SharedSegment::~SharedSegment() {
+	if (header()->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		shm_unlink(name_.c_str());
+	if (payload_)
+		munmap(payload_, mapped_size_);
+	munmap(ptr_, mapped_size_);
+	close(fd_);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2022 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+// Named POSIX shared memory segment with a reference counted header. The creator fills the
+// payload and publishes it, other processes attach with a private copy-on-write mapping of the
+// payload, so pages they do not modify stay shared. The name is unlinked when the last process
+// detaches. Attaching fails (returns nullptr) if the creator died before publishing the payload,
+// if it did not publish it within a short timeout, or if the segment is being unlinked.
+struct SharedSegment {
+
+	SharedSegment(const SharedSegment&) = delete;
+	SharedSegment& operator=(const SharedSegment&) = delete;
+	~SharedSegment();
+
+	// Returns nullptr if no segment of this name exists.
+	static SharedSegment* attach(const std::string& name);
+	// Returns nullptr if a segment of this name already exists.
+	static SharedSegment* create(const std::string& name, size_t size);
+
+	void publish();
+	const char* data() const;
+	char* data();
+	size_t size() const;
+
+private:
+
+	struct Header {
+		uint64_t magic;
+		std::atomic<int32_t> state;
+		// Once the count has dropped to 0, the segment is unlinked and can not be attached anymore.
+		std::atomic<int32_t> refs;
+		uint64_t size;
+		int64_t creator_pid;
+	};
+
+	enum { INIT = 0, READY = 1 };
+	static constexpr uint64_t MAGIC_NUMBER = 0x8d4c1f1e5a3b0d71llu;
+	static const size_t HEADER_SIZE = 64;
+
+	SharedSegment(const std::string& name, int fd, char* ptr, char* payload, size_t mapped_size);
+	Header* header() const;
+
+	const std::string name_;
+	const int fd_;
+	// Shared mapping used for the header, and for the payload by the creator.
+	char* ptr_;
+	// Private mapping of the segment of an attached process, or nullptr.
+	char* payload_;
+	const size_t mapped_size_;
+
+};
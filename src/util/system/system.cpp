@@ -191,6 +191,18 @@ void unmap_file(char* ptr, size_t size, int fd) {
 #endif
 }
 
+void advise_mapping(const char* ptr, size_t size, MmapAccess access) {
+#ifndef WIN32
+	int advice = POSIX_MADV_NORMAL;
+	if (access == MmapAccess::SEQUENTIAL)
+		advice = POSIX_MADV_SEQUENTIAL;
+	else if (access == MmapAccess::RANDOM)
+		advice = POSIX_MADV_RANDOM;
+	if (size > 0)
+		posix_madvise((void*)ptr, size, advice);
+#endif
+}
+
 size_t l3_cache_size() {
 #if defined(_MSC_VER) || defined(__APPLE__) || defined(__FreeBSD__) || (! defined(_SC_LEVEL3_CACHE_SIZE))
 	return 0;
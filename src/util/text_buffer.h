@@ -180,7 +180,7 @@ struct TextBuffer
 	{
 		//write(x);
 		reserve(16);
-		ptr_ += sprintf(ptr_, "%u", x);
+		ptr_ += Util::String::format_uint(x, ptr_);
 		return *this;
 	}
 
@@ -188,35 +188,35 @@ struct TextBuffer
 	{
 		//write(x);
 		reserve(16);
-		ptr_ += sprintf(ptr_, "%i", x);
+		ptr_ += Util::String::format_int(x, ptr_);
 		return *this;
 	}
 
 	TextBuffer& operator<<(unsigned long x)
 	{
 		reserve(32);
-		ptr_ += sprintf(ptr_, "%lu", x);
+		ptr_ += Util::String::format_uint(x, ptr_);
 		return *this;
 	}
 	
 	TextBuffer& operator<<(unsigned long long x)
 	{
 		reserve(32);
-		ptr_ += sprintf(ptr_, "%llu", x);
+		ptr_ += Util::String::format_uint(x, ptr_);
 		return *this;
 	}
 
 	TextBuffer& operator<<(long x)
 	{
 		reserve(32);
-		ptr_ += sprintf(ptr_, "%li", x);
+		ptr_ += Util::String::format_int(x, ptr_);
 		return *this;
 	}
 
 	TextBuffer& operator<<(long long x)
 	{
 		reserve(32);
-		ptr_ += sprintf(ptr_, "%lli", x);
+		ptr_ += Util::String::format_int(x, ptr_);
 		return *this;
 	}
 
@@ -230,7 +230,7 @@ struct TextBuffer
 	TextBuffer& print_d(double x)
 	{
 		reserve(32);
-		ptr_ += sprintf(ptr_, "%lf", x);
+		ptr_ += Util::String::format_f6(x, ptr_);
 		return *this;
 	}
 
@@ -240,7 +240,7 @@ struct TextBuffer
 		if (x == 0.0)
 			ptr_ += sprintf(ptr_, "0.0");
 		else
-			ptr_ += sprintf(ptr_, "%.2e", x);
+			ptr_ += Util::String::format_e2(x, ptr_);
 		return *this;
 	}
 
@@ -105,8 +105,9 @@ void File::write(const Record& record) {
 }
 
 void File::write(const Table& table) {
-	for (int64_t i = 0; i < table.size(); ++i)
-		write(table[i]);
+	table.write(write_buf_);
+	out_file_->write(write_buf_.data(), write_buf_.size());
+	write_buf_.clear();
 }
 
 File* File::map(int threads, std::function<Table(const Record&)>& f) {